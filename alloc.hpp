@@ -0,0 +1,229 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <malloc.h>
+
+namespace Win32GameEngine {
+	using namespace std;
+
+	// A number of heap allocations and the bytes they asked for. Only
+	// counted when WIN32GE_TRACK_ALLOCATIONS is defined, see below;
+	// otherwise always zero.
+	struct Allocations {
+		unsigned long long count = 0, bytes = 0;
+		inline Allocations operator-(Allocations const &r) const {
+			return { count - r.count, bytes - r.bytes };
+		}
+		inline Allocations &operator+=(Allocations const &r) {
+			count += r.count;
+			bytes += r.bytes;
+			return *this;
+		}
+		// Totals since the program started.
+		static inline atomic<unsigned long long> total_count{ 0 }, total_bytes{ 0 };
+		static inline Allocations now() {
+			return { total_count.load(memory_order_relaxed), total_bytes.load(memory_order_relaxed) };
+		}
+		static inline void record(size_t size) {
+			total_count.fetch_add(1, memory_order_relaxed);
+			total_bytes.fetch_add(size, memory_order_relaxed);
+		}
+	};
+
+	// Linear allocator for data living no longer than a frame. Allocating
+	// bumps a pointer; nothing is freed until reset(), which the game
+	// calls at the start of each update. When a frame outgrows the arena,
+	// extra blocks are taken from the heap and merged into one at the
+	// next reset, so a steady frame runs out of a single block and never
+	// touches the heap. Not thread-safe: use it from the game's thread.
+	class FrameArena {
+	protected:
+		struct Block {
+			unique_ptr<unsigned char[]> data;
+			size_t size;
+		};
+		vector<Block> blocks;
+		// Bytes taken from the last block, and from the full ones before it.
+		size_t offset, spilled;
+		void grow(size_t size) {
+			spilled += offset;
+			blocks.push_back({ unique_ptr<unsigned char[]>(new unsigned char[size]), size });
+			offset = 0;
+		}
+	public:
+		static constexpr size_t default_size = 64 << 10;
+		// Most bytes used by a frame so far.
+		size_t peak;
+		FrameArena(size_t size = default_size) : offset(0), spilled(0), peak(0) {
+			grow(size);
+		}
+		FrameArena(FrameArena const &) = delete;
+		inline size_t used() const { return spilled + offset; }
+		size_t capacity() const {
+			size_t res = 0;
+			for(Block const &block : blocks)
+				res += block.size;
+			return res;
+		}
+		void *allocate(size_t size, size_t alignment = alignof(max_align_t)) {
+			for(;;) {
+				Block const &block = blocks.back();
+				uintptr_t const base = (uintptr_t)block.data.get();
+				uintptr_t const address = (base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+				if(address + size <= base + block.size) {
+					offset = address + size - base;
+					return (void *)address;
+				}
+				grow(std::max(block.size * 2, size + alignment));
+			}
+		}
+		// Frees everything allocated since the last reset.
+		void reset() {
+			peak = std::max(peak, used());
+			if(blocks.size() > 1) {
+				size_t const size = capacity();
+				blocks.clear();
+				blocks.push_back({ unique_ptr<unsigned char[]>(new unsigned char[size]), size });
+			}
+			offset = spilled = 0;
+		}
+	};
+
+	// Standard allocator over a frame arena, for containers of transient
+	// data. Deallocation does nothing; the arena's reset frees it all.
+	template<typename T>
+	struct FrameAllocator {
+		using value_type = T;
+		FrameArena *arena;
+		FrameAllocator(FrameArena &arena) : arena(&arena) {}
+		template<typename U>
+		FrameAllocator(FrameAllocator<U> const &r) : arena(r.arena) {}
+		inline T *allocate(size_t n) {
+			return (T *)arena->allocate(n * sizeof(T), alignof(T));
+		}
+		inline void deallocate(T *, size_t) {}
+		template<typename U>
+		inline bool operator==(FrameAllocator<U> const &r) const { return arena == r.arena; }
+	};
+	template<typename T>
+	using FrameVector = vector<T, FrameAllocator<T>>;
+
+	// Keeps large aligned blocks, such as bitmap pixels, for reuse by size
+	// class, so that buffers dropped on a scene switch serve the next
+	// scene instead of going back to the heap. Thread-safe.
+	class BufferPool {
+	public:
+		static constexpr size_t alignment = 64;
+		struct Stats {
+			// Bytes handed out and not yet returned, and bytes kept for reuse.
+			size_t live = 0, pooled = 0;
+			// Requests served from the pool, and from the heap.
+			unsigned long long hits = 0, misses = 0;
+		};
+	protected:
+		mutex lock;
+		map<size_t, vector<void *>> idle;
+		Stats stats;
+	public:
+		// Most bytes kept for reuse; blocks returned beyond it are freed.
+		size_t limit;
+		BufferPool(size_t limit = 256 << 20) : limit(limit) {}
+		BufferPool(BufferPool const &) = delete;
+		~BufferPool() {
+			trim();
+		}
+		// Bytes actually reserved for a request: powers of two up to 4 KB,
+		// then four classes per power of two, wasting under a quarter.
+		static size_t bucket(size_t bytes) {
+			if(bytes <= 4096)
+				return std::max(bit_ceil(bytes), alignment);
+			size_t const step = bit_floor(bytes - 1) / 4;
+			return (bytes + step - 1) / step * step;
+		}
+		void *allocate(size_t bytes) {
+			size_t const size = bucket(bytes);
+			{
+				lock_guard<mutex> guard(lock);
+				stats.live += size;
+				auto const it = idle.find(size);
+				if(it != idle.end() && !it->second.empty()) {
+					void *const p = it->second.back();
+					it->second.pop_back();
+					stats.pooled -= size;
+					++stats.hits;
+					return p;
+				}
+				++stats.misses;
+			}
+#ifdef WIN32GE_TRACK_ALLOCATIONS
+			Allocations::record(size);
+#endif
+			if(void *const p = _aligned_malloc(size, alignment))
+				return p;
+			lock_guard<mutex> guard(lock);
+			stats.live -= size;
+			throw bad_alloc();
+		}
+		// Returns a block from allocate(`bytes`).
+		void deallocate(void *p, size_t bytes) {
+			size_t const size = bucket(bytes);
+			{
+				lock_guard<mutex> guard(lock);
+				stats.live -= size;
+				if(stats.pooled + size <= limit) {
+					idle[size].push_back(p);
+					stats.pooled += size;
+					return;
+				}
+			}
+			_aligned_free(p);
+		}
+		// Frees every block kept for reuse.
+		void trim() {
+			map<size_t, vector<void *>> blocks;
+			{
+				lock_guard<mutex> guard(lock);
+				blocks.swap(idle);
+				stats.pooled = 0;
+			}
+			for(auto &[size, list] : blocks) {
+				for(void *const p : list)
+					_aligned_free(p);
+			}
+		}
+		Stats getstats() {
+			lock_guard<mutex> guard(lock);
+			return stats;
+		}
+	};
+}
+
+// Defining WIN32GE_TRACK_ALLOCATIONS replaces the global operator new and
+// delete with ones counting into Allocations. The replacements are
+// program-wide definitions, so define it in one translation unit only.
+#ifdef WIN32GE_TRACK_ALLOCATIONS
+void *operator new(size_t size) {
+	Win32GameEngine::Allocations::record(size);
+	if(void *const p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void *operator new(size_t size, std::align_val_t alignment) {
+	Win32GameEngine::Allocations::record(size);
+	if(void *const p = _aligned_malloc(size ? size : 1, (size_t)alignment))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *p, std::align_val_t) noexcept { _aligned_free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { _aligned_free(p); }
+#endif
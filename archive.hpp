@@ -0,0 +1,274 @@
+#pragma once
+
+#include "utils.hpp"
+#include <string>
+#include <unordered_map>
+
+namespace Win32GameEngine {
+	// An archive file is laid out as:
+	//   ArchiveHeader
+	//   ArchiveEntry[count]
+	//   entry names, as UTF-16 code units without terminators
+	//   for each entry, its opacity blocks, one byte each, then its
+	//   pixels at an archive_alignment boundary
+	// Uncompressed pixels are Colors exactly as a linear Bitmap holds them,
+	// row padding included, so a mapped archive can be drawn from without
+	// converting anything.
+	constexpr char archive_magic[4] = { 'W', 'G', 'E', 'A' };
+	constexpr unsigned archive_version = 2;
+	constexpr unsigned archive_alignment = 64;
+
+	enum class ArchiveCompression : unsigned {
+		NONE,
+		// Runs of one color, and literal spans. Each packet is a 32-bit
+		// count, with the top bit set for a run, followed by one Color for
+		// a run or `count` Colors for a literal span.
+		RLE
+	};
+
+	struct ArchiveHeader {
+		char magic[4];
+		unsigned version, count, reserved;
+	};
+	struct ArchiveEntry {
+		// File offsets of the pixels and the opacity blocks, and the bytes
+		// of pixels stored.
+		unsigned long long pixels, blocks, stored;
+		// Offset from the start of the names in UTF-16 code units, and length.
+		unsigned name, name_length;
+		unsigned width, height;
+		PixelFormat format;
+		ArchiveCompression compression;
+		Opacity opacity;
+		unsigned reserved;
+	};
+
+	// Builds an archive offline from bitmaps, for Archive to read.
+	class ArchiveWriter {
+	protected:
+		struct Item {
+			wstring name;
+			Bitmap bitmap;
+			bool compress;
+		};
+		vector<Item> items;
+		static void encode(Color const *src, size_t count, vector<unsigned> &out) {
+			auto same = [&](size_t a, size_t b) {
+				return bit_cast<unsigned>(src[a]) == bit_cast<unsigned>(src[b]);
+			};
+			for(size_t i = 0; i < count; ) {
+				size_t run = 1;
+				while(i + run < count && run < 0x7FFFFFFF && same(i, i + run))
+					++run;
+				if(run >= 3) {
+					out.push_back(0x80000000U | (unsigned)run);
+					out.push_back(bit_cast<unsigned>(src[i]));
+					i += run;
+					continue;
+				}
+				// Literals up to where a run of three starts.
+				size_t const start = i;
+				while(i < count && i - start < 0x7FFFFFFF && !(i + 2 < count && same(i, i + 1) && same(i, i + 2)))
+					++i;
+				out.push_back((unsigned)(i - start));
+				for(size_t j = start; j < i; ++j)
+					out.push_back(bit_cast<unsigned>(src[j]));
+			}
+		}
+	public:
+		// Compressed pixels are only kept when at most this fraction of
+		// their raw size, as they must be decoded on load.
+		float const compression_threshold;
+		ArchiveWriter(float compression_threshold = .75f) : compression_threshold(compression_threshold) {}
+		// Adds a bitmap under `name`, compressed if asked and worth it.
+		void add(wstring name, Bitmap const &bitmap, bool compress = false) {
+			Bitmap linear = bitmap.relayout(Layout::LINEAR);
+			if(!linear.blocks)
+				linear.analyze();
+			items.push_back({ name, linear, compress });
+		}
+		void save(ConstString url) const {
+			vector<char16_t> names;
+			vector<ArchiveEntry> entries(items.size());
+			vector<vector<unsigned>> packed(items.size());
+			unsigned long long offset = sizeof(ArchiveHeader) + sizeof(ArchiveEntry) * items.size();
+			for(Item const &item : items) {
+				for(wchar_t c : item.name)
+					names.push_back((char16_t)c);
+			}
+			offset += names.size() * sizeof(char16_t);
+			unsigned name = 0;
+			for(size_t i = 0; i < items.size(); ++i) {
+				Item const &item = items[i];
+				Bitmap const &b = item.bitmap;
+				ArchiveEntry &e = entries[i];
+				e = {};
+				e.name = name;
+				e.name_length = (unsigned)item.name.size();
+				name += e.name_length;
+				e.width = b.dimension[0];
+				e.height = b.dimension[1];
+				e.format = b.format;
+				e.opacity = b.opacity;
+				e.blocks = offset;
+				offset += b.blocks->size();
+				offset = (offset + archive_alignment - 1) / archive_alignment * archive_alignment;
+				e.pixels = offset;
+				e.stored = (unsigned long long)b.size * sizeof(Color);
+				if(item.compress) {
+					encode(b.data.get(), b.size, packed[i]);
+					unsigned long long const size = packed[i].size() * sizeof(unsigned);
+					if(size <= e.stored * compression_threshold) {
+						e.compression = ArchiveCompression::RLE;
+						e.stored = size;
+					}
+					else
+						vector<unsigned>().swap(packed[i]);
+				}
+				offset += e.stored;
+			}
+			auto path = filesystem::current_path();
+			path.append(url);
+			FILE *file = nullptr;
+			_wfopen_s(&file, path.c_str(), L"wb");
+			if(!file)
+				throw L"Cannot create archive.";
+			ArchiveHeader header{};
+			copy(begin(archive_magic), end(archive_magic), header.magic);
+			header.version = archive_version;
+			header.count = (unsigned)items.size();
+			fwrite(&header, sizeof(header), 1, file);
+			fwrite(entries.data(), sizeof(ArchiveEntry), entries.size(), file);
+			fwrite(names.data(), sizeof(char16_t), names.size(), file);
+			char const padding[archive_alignment] = {};
+			for(size_t i = 0; i < items.size(); ++i) {
+				ArchiveEntry const &e = entries[i];
+				Bitmap const &b = items[i].bitmap;
+				for(Opacity const block : *b.blocks) {
+					unsigned char const byte = (unsigned char)block;
+					fwrite(&byte, 1, 1, file);
+				}
+				fwrite(padding, 1, e.pixels - e.blocks - b.blocks->size(), file);
+				if(e.compression == ArchiveCompression::RLE)
+					fwrite(packed[i].data(), sizeof(unsigned), packed[i].size(), file);
+				else
+					fwrite(b.data.get(), sizeof(Color), b.size, file);
+			}
+			bool const failed = ferror(file);
+			fclose(file);
+			if(failed)
+				throw L"Cannot write archive.";
+		}
+	};
+
+	// A mapped archive. Opening it reads only the header and the table of
+	// contents; an uncompressed bitmap taken from it points into the
+	// mapping, so its pixels are read from disk as they are first touched.
+	// The mapping is copy-on-write, and stays open while any such bitmap
+	// does.
+	class Archive {
+	protected:
+		shared_ptr<MappedFile> file;
+		ArchiveEntry const *entries;
+		unsigned count;
+		char16_t const *names;
+		unordered_map<wstring, unsigned> index;
+		static void decode(unsigned const *src, size_t stored, Color *dest, size_t count) {
+			size_t i = 0, o = 0;
+			while(i < stored) {
+				unsigned const packet = src[i++];
+				size_t const n = packet & 0x7FFFFFFF;
+				if(o + n > count || i + (packet & 0x80000000U ? 1 : n) > stored)
+					throw L"Corrupt archive.";
+				if(packet & 0x80000000U)
+					fill_n(dest + o, n, bit_cast<Color>(src[i++]));
+				else {
+					memcpy(dest + o, src + i, n * sizeof(Color));
+					i += n;
+				}
+				o += n;
+			}
+			if(o != count)
+				throw L"Corrupt archive.";
+		}
+	public:
+		Archive(ConstString url) : file(make_shared<MappedFile>(url, true)) {
+			unsigned char const *const data = file->data;
+			size_t const size = file->size;
+			if(size < sizeof(ArchiveHeader))
+				throw L"Not an archive.";
+			ArchiveHeader const &header = *(ArchiveHeader const *)data;
+			if(!equal(begin(archive_magic), end(archive_magic), header.magic))
+				throw L"Not an archive.";
+			if(header.version != archive_version)
+				throw L"Unsupported archive version.";
+			unsigned long long const toc = sizeof(ArchiveHeader) + (unsigned long long)sizeof(ArchiveEntry) * header.count;
+			if(toc > size)
+				throw L"Corrupt archive.";
+			entries = (ArchiveEntry const *)(data + sizeof(ArchiveHeader));
+			count = header.count;
+			names = (char16_t const *)(data + toc);
+			index.reserve(header.count);
+			for(unsigned i = 0; i < header.count; ++i) {
+				ArchiveEntry const &e = entries[i];
+				unsigned long long const blocks =
+					(unsigned long long)((e.width + Bitmap::opacity_block - 1) / Bitmap::opacity_block) *
+					((e.height + Bitmap::opacity_block - 1) / Bitmap::opacity_block);
+				if(
+					toc + (e.name + (unsigned long long)e.name_length) * sizeof(char16_t) > size ||
+					e.blocks + blocks > size || e.pixels + e.stored > size || e.pixels % archive_alignment ||
+					e.compression > ArchiveCompression::RLE || e.format > PixelFormat::PREMULTIPLIED || e.opacity > Opacity::MIXED ||
+					(e.compression == ArchiveCompression::NONE && e.stored != (unsigned long long)Bitmap::storage({ e.width, e.height }, Layout::LINEAR) * sizeof(Color))
+				)
+					throw L"Corrupt archive.";
+				index.emplace(wstring(names + e.name, names + e.name + e.name_length), i);
+			}
+		}
+		inline unsigned size() const { return count; }
+		inline bool contains(ConstString name) const { return index.find(name) != index.end(); }
+		inline wstring name(unsigned i) const {
+			if(i >= size())
+				throw L"Asset not in archive.";
+			ArchiveEntry const &e = entries[i];
+			return wstring(names + e.name, names + e.name + e.name_length);
+		}
+		// The bitmap stored under `name`.
+		Bitmap get(ConstString name) const {
+			auto const it = index.find(name);
+			if(it == index.end())
+				throw L"Asset not in archive.";
+			return get(it->second);
+		}
+		// The `i`th bitmap in the archive.
+		Bitmap get(unsigned i) const {
+			if(i >= size())
+				throw L"Asset not in archive.";
+			ArchiveEntry const &e = entries[i];
+			Vec2U const dimension{ e.width, e.height };
+			unsigned char *const data = const_cast<unsigned char *>(file->data);
+			shared_ptr<Color> pixels;
+			if(e.compression == ArchiveCompression::NONE)
+				// Shares ownership of the mapping; no pixel is copied.
+				pixels = shared_ptr<Color>(file, (Color *)(data + e.pixels));
+			else {
+				unsigned const count = Bitmap::storage(dimension, Layout::LINEAR);
+				pixels = Bitmap::allocate(count);
+				decode((unsigned const *)(data + e.pixels), (size_t)(e.stored / sizeof(unsigned)), pixels.get(), count);
+			}
+			Bitmap res(dimension, pixels, e.format);
+			unsigned char const *const blocks = data + e.blocks;
+			unsigned const bw = (e.width + Bitmap::opacity_block - 1) / Bitmap::opacity_block;
+			unsigned const bh = (e.height + Bitmap::opacity_block - 1) / Bitmap::opacity_block;
+			res.blocks = make_shared<vector<Opacity>>(bw * bh);
+			// Checked here rather than on opening, which reads no more than
+			// the table of contents.
+			for(unsigned b = 0; b < bw * bh; ++b) {
+				if(blocks[b] > (unsigned char)Opacity::MIXED)
+					throw L"Corrupt archive.";
+				(*res.blocks)[b] = (Opacity)blocks[b];
+			}
+			res.opacity = e.opacity;
+			return res;
+		}
+	};
+}
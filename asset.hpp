@@ -0,0 +1,209 @@
+#pragma once
+
+#include "utils.hpp"
+#include <chrono>
+#include <optional>
+#include <string>
+#include <tuple>
+
+namespace Win32GameEngine {
+	class AssetLoader;
+
+	// A bitmap loading in the background. It only changes when its loader
+	// publishes it, on the game thread at the start of an update, so it
+	// can be read from game code without locking.
+	class BitmapAsset {
+		friend AssetLoader;
+	public:
+		enum class State { LOADING, READY, FAILED };
+	protected:
+		State state;
+		optional<Bitmap> bitmap;
+		wstring error;
+		vector<function<void(BitmapAsset const &)>> waiting;
+	public:
+		wstring const path;
+		BitmapAsset(wstring path) : state(State::LOADING), path(path) {}
+		inline State getstate() const { return state; }
+		inline bool isready() const { return state == State::READY; }
+		// The loaded bitmap. Throws unless ready.
+		Bitmap const &get() const {
+			if(state != State::READY)
+				throw L"Asset not loaded.";
+			return *bitmap;
+		}
+		// Why loading failed, if it did.
+		inline wstring const &geterror() const { return error; }
+		// Calls `f` on the game thread once the asset is published, or
+		// right away if it already is.
+		void then(function<void(BitmapAsset const &)> f) {
+			if(state == State::LOADING)
+				waiting.push_back(move(f));
+			else
+				f(*this);
+		}
+	};
+	using AssetHandle = shared_ptr<BitmapAsset>;
+
+	// Loads bitmaps on background threads, so that the game thread never
+	// waits on a file. Requests for a path already loading or still held
+	// share one asset. Results are handed back at publish(), which the
+	// game calls at the start of each update.
+	class AssetLoader {
+	public:
+		struct Stats {
+			// Requests waiting for a worker, being loaded, and loaded but
+			// not yet published.
+			unsigned queued = 0, loading = 0, finished = 0;
+			unsigned long long loaded = 0, failed = 0;
+			// Requests answered with an asset already loading or loaded.
+			unsigned long long shared = 0;
+			// Milliseconds from request to publication, of the last asset
+			// and on average.
+			double latency = 0, mean_latency = 0;
+		};
+	protected:
+		using Key = tuple<wstring, PixelFormat, bool>;
+		struct Job {
+			AssetHandle asset;
+			PixelFormat format;
+			bool mipmapped;
+			chrono::steady_clock::time_point requested;
+			// Written by the worker, read at publication.
+			optional<Bitmap> bitmap;
+			wstring error;
+		};
+		unsigned const threads;
+		vector<thread> workers;
+		mutex lock;
+		condition_variable wake;
+		deque<unique_ptr<Job>> queue;
+		vector<unique_ptr<Job>> finished, publishing;
+		unsigned loading;
+		bool stopping;
+		map<Key, weak_ptr<BitmapAsset>> assets;
+		// Size of `assets` at which entries of released assets are swept.
+		size_t sweep_at;
+		Stats stats;
+		void work() {
+			for(;;) {
+				unique_ptr<Job> job;
+				{
+					unique_lock<mutex> guard(lock);
+					wake.wait(guard, [&]() { return stopping || !queue.empty(); });
+					if(stopping)
+						return;
+					job = move(queue.front());
+					queue.pop_front();
+					++loading;
+				}
+				try {
+					job->bitmap.emplace(Bitmap::fromfile(job->asset->path.c_str(), job->format, job->mipmapped));
+				}
+				catch(wchar_t const *e) {
+					job->error = e;
+				}
+				// Anything else, such as running out of memory or the file
+				// system failing, fails the asset too rather than escaping
+				// the thread.
+				catch(exception const &e) {
+					string const what = e.what();
+					job->error = wstring(what.begin(), what.end());
+				}
+				catch(...) {
+					job->error = L"Cannot load asset.";
+				}
+				lock_guard<mutex> guard(lock);
+				--loading;
+				finished.push_back(move(job));
+			}
+		}
+	public:
+		// `threads` background threads, by default all cores but one.
+		AssetLoader(unsigned threads = 0) :
+			threads(threads ? threads : std::max(thread::hardware_concurrency(), 2U) - 1),
+			loading(0), stopping(false), sweep_at(64) {}
+		AssetLoader(AssetLoader const &) = delete;
+		~AssetLoader() {
+			{
+				lock_guard<mutex> guard(lock);
+				stopping = true;
+			}
+			wake.notify_all();
+			for(thread &worker : workers)
+				worker.join();
+		}
+		// Starts loading a BMP file as Bitmap::fromfile() would, or returns
+		// the asset of an identical request still loading or held. A failed
+		// load is never shared, so asking again retries it.
+		AssetHandle load(ConstString path, PixelFormat format = PixelFormat::PREMULTIPLIED, bool mipmapped = false) {
+			if(assets.size() >= sweep_at) {
+				erase_if(assets, [](auto const &entry) { return entry.second.expired(); });
+				sweep_at = std::max<size_t>(64, assets.size() * 2);
+			}
+			weak_ptr<BitmapAsset> &slot = assets[Key(path, format, mipmapped)];
+			AssetHandle const existing = slot.lock();
+			if(existing && existing->state != BitmapAsset::State::FAILED) {
+				++stats.shared;
+				return existing;
+			}
+			AssetHandle const asset = make_shared<BitmapAsset>(path);
+			slot = asset;
+			{
+				lock_guard<mutex> guard(lock);
+				queue.push_back(make_unique<Job>(Job{ asset, format, mipmapped, chrono::steady_clock::now() }));
+			}
+			// Threads start with the first request.
+			if(workers.empty()) {
+				for(unsigned i = 0; i < threads; ++i)
+					workers.emplace_back([this]() { work(); });
+			}
+			wake.notify_one();
+			return asset;
+		}
+		// Hands finished loads to their assets and runs their callbacks.
+		// Call from the game thread.
+		void publish() {
+			{
+				lock_guard<mutex> guard(lock);
+				finished.swap(publishing);
+			}
+			auto const now = chrono::steady_clock::now();
+			for(unique_ptr<Job> &job : publishing) {
+				BitmapAsset &asset = *job->asset;
+				if(job->bitmap) {
+					asset.bitmap.emplace(*job->bitmap);
+					asset.state = BitmapAsset::State::READY;
+					++stats.loaded;
+				}
+				else {
+					asset.error = job->error;
+					asset.state = BitmapAsset::State::FAILED;
+					++stats.failed;
+				}
+				stats.latency = chrono::duration<double, milli>(now - job->requested).count();
+				unsigned long long const count = stats.loaded + stats.failed;
+				stats.mean_latency += (stats.latency - stats.mean_latency) / count;
+				vector<function<void(BitmapAsset const &)>> waiting;
+				waiting.swap(asset.waiting);
+				for(auto &f : waiting)
+					f(asset);
+				// Nobody kept the asset: forget it along with the job.
+				if(job->asset.use_count() == 1) {
+					auto const it = assets.find(Key(asset.path, job->format, job->mipmapped));
+					if(it != assets.end() && it->second.lock() == job->asset)
+						assets.erase(it);
+				}
+			}
+			publishing.clear();
+		}
+		Stats getstats() {
+			Stats res = stats;
+			lock_guard<mutex> guard(lock);
+			res.queued = (unsigned)queue.size();
+			res.loading = loading;
+			res.finished = (unsigned)finished.size();
+			return res;
+		}
+	};
+}
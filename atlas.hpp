@@ -0,0 +1,163 @@
+#pragma once
+
+#include "buffer.hpp"
+#include <chrono>
+
+namespace Win32GameEngine {
+	// A rectangle of an atlas page holding one packed bitmap.
+	struct AtlasRegion {
+		Bitmap page;
+		Vec2U offset, size;
+	};
+
+	// Packs many bitmaps into a few large premultiplied pages, so sprites
+	// drawn together sample from the same few pixel buffers. Each page is
+	// filled by a skyline packer: the top edge of the packed area is kept
+	// as horizontal segments, and each bitmap goes where its bottom ends
+	// lowest.
+	class Atlas {
+	protected:
+		struct Segment {
+			unsigned x, y, width;
+		};
+		struct Page {
+			Bitmap bitmap;
+			vector<Segment> skyline;
+		};
+		vector<Page> pages;
+		// Lowest y at which a `width` wide rectangle fits starting at
+		// segment `i`, or UINT_MAX if it runs off the page.
+		unsigned fit(Page const &page, size_t i, unsigned width, unsigned height) const {
+			vector<Segment> const &skyline = page.skyline;
+			unsigned const x = skyline[i].x;
+			if(x + width > page_size[0])
+				return UINT_MAX;
+			unsigned y = 0;
+			for(size_t j = i; j < skyline.size() && skyline[j].x < x + width; ++j)
+				y = std::max(y, skyline[j].y);
+			return y + height > page_size[1] ? UINT_MAX : y;
+		}
+		// Raises the skyline over a rectangle placed at (x, y).
+		static void place(vector<Segment> &skyline, unsigned x, unsigned y, unsigned width, unsigned height) {
+			size_t i = 0;
+			while(skyline[i].x < x)
+				++i;
+			skyline.insert(skyline.begin() + i, Segment{ x, y + height, width });
+			// Cut the segments now under the new one.
+			unsigned const end = x + width;
+			for(size_t j = i + 1; j < skyline.size() && skyline[j].x < end; ) {
+				Segment &s = skyline[j];
+				unsigned const s_end = s.x + s.width;
+				if(s_end <= end) {
+					skyline.erase(skyline.begin() + j);
+					continue;
+				}
+				s.width = s_end - end;
+				s.x = end;
+				break;
+			}
+			// Merge neighbors of equal height.
+			for(size_t j = 0; j + 1 < skyline.size(); ) {
+				if(skyline[j].y == skyline[j + 1].y) {
+					skyline[j].width += skyline[j + 1].width;
+					skyline.erase(skyline.begin() + j + 1);
+				}
+				else
+					++j;
+			}
+		}
+		// Best placement on a page as (x, y), or false if none.
+		bool find(Page const &page, unsigned width, unsigned height, unsigned &x, unsigned &y) const {
+			unsigned best = UINT_MAX;
+			for(size_t i = 0; i < page.skyline.size(); ++i) {
+				unsigned const top = fit(page, i, width, height);
+				if(top == UINT_MAX || top + height >= best)
+					continue;
+				best = top + height;
+				x = page.skyline[i].x;
+				y = top;
+			}
+			return best != UINT_MAX;
+		}
+	public:
+		Vec2U const page_size;
+		// Empty texels kept right of and below each bitmap, so rounding at
+		// a region's edge does not pick up its neighbors. Regions are not
+		// aligned, so a mip level only stays clear of them while its
+		// texels span no more than the padding plus one; see buildmips().
+		unsigned const padding;
+		Layout const layout;
+		struct Stats {
+			// Total time spent packing and copying, in milliseconds.
+			double pack_time = 0;
+			// Texels of packed bitmaps, padding excluded.
+			unsigned long long used = 0;
+			unsigned bitmaps = 0;
+		} stats;
+		Atlas(Vec2U page_size = { 1024, 1024 }, unsigned padding = 1, Layout layout = Layout::LINEAR) :
+			page_size(page_size), padding(padding), layout(layout) {}
+		inline unsigned pagecount() const { return (unsigned)pages.size(); }
+		inline Bitmap const &page(unsigned i) const { return pages[i].bitmap; }
+		// Fraction of the pages' texels holding packed bitmaps.
+		inline float utilization() const {
+			unsigned long long const total = (unsigned long long)page_size[0] * page_size[1] * pages.size();
+			return total ? (float)stats.used / total : 0;
+		}
+		// Copies a bitmap into the first page with room, opening a new page
+		// when none has any.
+		AtlasRegion add(Bitmap const &bitmap) {
+			auto const start = chrono::steady_clock::now();
+			Vec2U const size = bitmap.dimension;
+			unsigned const width = size[0] + padding, height = size[1] + padding;
+			if(size[0] > page_size[0] || size[1] > page_size[1])
+				throw L"Bitmap larger than atlas page.";
+			unsigned x = 0, y = 0;
+			size_t p = 0;
+			for(; p < pages.size(); ++p) {
+				if(find(pages[p], std::min(width, page_size[0]), std::min(height, page_size[1]), x, y))
+					break;
+			}
+			if(p == pages.size()) {
+				pages.push_back({ Bitmap(page_size, PixelFormat::PREMULTIPLIED, layout), { Segment{ 0, 0, page_size[0] } } });
+				pages.back().bitmap.analyze();
+				x = y = 0;
+			}
+			Page &page = pages[p];
+			place(page.skyline, x, y, std::min(width, page_size[0] - x), std::min(height, page_size[1] - y));
+			Bitmap const source = bitmap.as(PixelFormat::PREMULTIPLIED);
+			if(page.bitmap.layout == Layout::LINEAR && source.layout == Layout::LINEAR)
+				page.bitmap.view().sub({ x, y }, size).copy(source.view());
+			else {
+				Color const *const src = source.data.get();
+				Color *const dest = page.bitmap.data.get();
+				for(unsigned row = 0; row < size[1]; ++row) {
+					for(unsigned col = 0; col < size[0]; ++col)
+						dest[page.bitmap.locate(x + col, y + row)] = src[source.locate(col, row)];
+				}
+			}
+			page.bitmap.analyze({ x, y }, { x + size[0], y + size[1] });
+			stats.pack_time += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			stats.used += (unsigned long long)size[0] * size[1];
+			++stats.bitmaps;
+			return { page.bitmap, { x, y }, size };
+		}
+		// Mip levels a page can have without any level mixing texels of
+		// neighboring regions: those whose texels span at most padding + 1
+		// page texels. The edge texels of those levels still average in
+		// the transparent padding.
+		inline unsigned miplevels() const {
+			unsigned levels = 0;
+			while((2U << levels) <= padding + 1)
+				++levels;
+			return levels;
+		}
+		// Builds the mip pyramid of every page, up to miplevels(). Regions
+		// handed out before keep sampling without mips.
+		void buildmips() {
+			if(!miplevels())
+				return;
+			for(Page &page : pages)
+				page.bitmap.buildmips(miplevels());
+		}
+	};
+}
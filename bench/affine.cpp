@@ -0,0 +1,50 @@
+// Inverting and applying the affine matrices that transforms hold:
+// AffineMatrix::inverse() in closed form against the Gaussian
+// elimination of SquareMatrix::inverse(), and AffineMatrix::point().
+
+#include "bench.hpp"
+#include "../linear.hpp"
+#include <random>
+#include <vector>
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineBench;
+
+template<unsigned D>
+void run() {
+	constexpr unsigned count = 4096;
+	mt19937 random(2022);
+	uniform_real_distribution<float> entry(-2, 2);
+	vector<AffineMatrix<D, float>> matrices(count);
+	for(AffineMatrix<D, float> &m : matrices) {
+		for(unsigned i = 0; i < D - 1; ++i) {
+			for(unsigned j = 0; j < D; ++j)
+				m.data[i * D + j] = entry(random) + (i == j ? 4 : 0);
+		}
+	}
+	double const gaussian = measure([&]() {
+		float sum = 0;
+		for(AffineMatrix<D, float> const &m : matrices)
+			sum += ((SquareMatrix<D, float> const &)m).inverse().data[0];
+		sink = sum;
+	});
+	double const closed = measure([&]() {
+		float sum = 0;
+		for(AffineMatrix<D, float> const &m : matrices)
+			sum += m.inverse().data[0];
+		sink = sum;
+	});
+	typename AffineMatrix<D, float>::Point p;
+	double const point = measure([&]() {
+		for(AffineMatrix<D, float> const &m : matrices)
+			p = m.point(p) * .25f;
+		sink = p[0];
+	});
+	printf("%ux%u: inverse %.1f ns by elimination, %.1f ns closed form; point() %.1f ns\n",
+		D, D, gaussian * 1e6 / count, closed * 1e6 / count, point * 1e6 / count);
+}
+
+int main() {
+	run<4>();
+	run<3>();
+}
@@ -0,0 +1,94 @@
+// Loading 2000 64x64 assets from separate BMP files with
+// Bitmap::fromfile, against opening one archive of them and taking every
+// bitmap from it, uncompressed and compressed; each asset row is two
+// runs of one color, so all of them compress. Every loaded bitmap has
+// one pixel per row read, so mapped pixels are paged in. The files are
+// written to a scratch directory first.
+
+#include "bench.hpp"
+#include "../game.hpp"
+#include <fstream>
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineBench;
+
+// A top-down, 32-bit BMP file of `bitmap`.
+void writebmp(filesystem::path const &path, Bitmap const &bitmap) {
+	unsigned const w = bitmap.dimension[0], h = bitmap.dimension[1];
+	vector<char> out;
+	auto put = [&](unsigned value, unsigned bytes) {
+		for(unsigned i = 0; i < bytes; ++i)
+			out.push_back((char)(value >> i * 8));
+	};
+	out.push_back('B');
+	out.push_back('M');
+	put(54 + w * h * 4, 4);
+	put(0, 4);
+	put(54, 4);
+	put(40, 4);
+	put(w, 4);
+	put((unsigned)-(int)h, 4);
+	put(1, 2);
+	put(32, 2);
+	put(0, 4);
+	put(w * h * 4, 4);
+	put(2835, 4);
+	put(2835, 4);
+	put(0, 4);
+	put(0, 4);
+	for(unsigned y = 0; y < h; ++y) {
+		for(unsigned x = 0; x < w; ++x)
+			put(bit_cast<unsigned>(bitmap.data.get()[bitmap.locate(x, y)]), 4);
+	}
+	ofstream(path, ios::binary).write(out.data(), out.size());
+}
+
+// Reads a pixel of each row.
+unsigned touch(Bitmap const &bitmap) {
+	unsigned sum = 0;
+	for(unsigned y = 0; y < bitmap.dimension[1]; ++y)
+		sum += bit_cast<unsigned>(bitmap.data.get()[bitmap.locate(0, y)]);
+	return sum;
+}
+
+int main() {
+	constexpr unsigned count = 2000;
+	filesystem::path const dir = filesystem::absolute("archive_bench");
+	filesystem::create_directories(dir);
+	vector<wstring> files;
+	ArchiveWriter plain, packed;
+	for(unsigned i = 0; i < count; ++i) {
+		Bitmap bitmap(Vec2U{ 64, 64 });
+		for(unsigned y = 0; y < 64; ++y) {
+			for(unsigned x = 0; x < 64; ++x)
+				bitmap.data.get()[bitmap.locate(x, y)] = Color(x < 32 ? 0 : 255, y * 4, i & 255, 255);
+		}
+		wstring const name = to_wstring(i) + L".bmp";
+		files.push_back((dir / name).wstring());
+		writebmp(dir / name, bitmap);
+		plain.add(name, bitmap);
+		packed.add(name, bitmap, true);
+	}
+	wstring const plain_path = (dir / L"plain.wgea").wstring(), packed_path = (dir / L"packed.wgea").wstring();
+	plain.save(plain_path.c_str());
+	packed.save(packed_path.c_str());
+	double const bmp = measure([&]() {
+		unsigned sum = 0;
+		for(wstring const &file : files)
+			sum += touch(Bitmap::fromfile(file.c_str()));
+		sink = (float)sum;
+	}, 1);
+	auto fromarchive = [&](wstring const &path) {
+		return measure([&]() {
+			Archive const archive(path.c_str());
+			unsigned sum = 0;
+			for(unsigned i = 0; i < archive.size(); ++i)
+				sum += touch(archive.get(i));
+			sink = (float)sum;
+		}, 1);
+	};
+	double const mapped = fromarchive(plain_path), decoded = fromarchive(packed_path);
+	printf("%u assets: %.2f ms from BMP files, %.2f ms from an archive, %.2f ms from a compressed one\n",
+		count, bmp, mapped, decoded);
+	filesystem::remove_all(dir);
+}
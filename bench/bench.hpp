@@ -0,0 +1,32 @@
+#pragma once
+
+// Shared by the programs in this directory. Each one is a standalone
+// console program over the headers in the repository root, built
+// optimized, e.g.:
+//   cl /std:c++20 /O2 /EHsc /DUNICODE /D_UNICODE /arch:AVX2 dispatch.cpp user32.lib gdi32.lib
+// and prints its timings. Numbers only compare within one machine.
+
+#include <chrono>
+#include <cstdio>
+
+namespace Win32GameEngineBench {
+	// Milliseconds per call of `f`: the fastest of `rounds` rounds of
+	// `reps` calls, after one call to warm up.
+	template<typename F>
+	double measure(F &&f, unsigned reps = 10, unsigned rounds = 5) {
+		using Clock = std::chrono::steady_clock;
+		f();
+		double best = 1e300;
+		for(unsigned r = 0; r < rounds; ++r) {
+			Clock::time_point const start = Clock::now();
+			for(unsigned i = 0; i < reps; ++i)
+				f();
+			double const ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / reps;
+			if(ms < best)
+				best = ms;
+		}
+		return best;
+	}
+	// Keeps the optimizer from dropping a result.
+	inline volatile float sink;
+}
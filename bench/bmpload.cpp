@@ -0,0 +1,36 @@
+// Load throughput of Bitmap::fromfile over every .bmp file under a
+// directory, as counted by Bitmap::load_stats. Usage:
+//   bmpload <directory> [passes]
+// The first pass may include reading from disk; later ones come from
+// the file cache.
+
+#include "bench.hpp"
+#include "../game.hpp"
+#include <cstdlib>
+
+using namespace Win32GameEngine;
+
+int main(int argc, char **argv) {
+	if(argc < 2) {
+		printf("usage: bmpload <directory> [passes]\n");
+		return 1;
+	}
+	vector<wstring> paths;
+	for(filesystem::directory_entry const &entry : filesystem::recursive_directory_iterator(argv[1])) {
+		if(entry.is_regular_file() && entry.path().extension() == ".bmp")
+			paths.push_back(filesystem::absolute(entry.path()).wstring());
+	}
+	unsigned const passes = argc > 2 ? atoi(argv[2]) : 3;
+	for(unsigned pass = 0; pass < passes; ++pass) {
+		Bitmap::load_stats.files = Bitmap::load_stats.bytes = Bitmap::load_stats.microseconds = 0;
+		for(wstring const &path : paths) {
+			try {
+				Bitmap::fromfile(path.c_str());
+			} catch(ConstString) {
+				printf("cannot load %ls\n", path.c_str());
+			}
+		}
+		printf("pass %u: %llu files, %.1f MB, %.0f MB/s\n", pass + 1,
+			Bitmap::load_stats.files.load(), Bitmap::load_stats.bytes / 1e6, Bitmap::load_stats.throughput());
+	}
+}
@@ -0,0 +1,72 @@
+// Dispatching game events down 1000 nodes of 100 children each, every
+// child listening to UPDATE and to four other event types as engine
+// components do: UPDATE reaches all 100k children, and MOUSEDOWN none.
+// EventDistributor and its enum-indexed HandlerTable run against the
+// map of handler sets it replaced, kept below as MapDistributor; both
+// call the same Handler type and walk the same tree.
+
+#include "bench.hpp"
+#include "../game.hpp"
+#include <map>
+#include <set>
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineBench;
+
+struct MapDistributor : Receiver<GameEvent> {
+	map<GameEventType, set<Handler<GameEvent> *>> receivers;
+	~MapDistributor() {
+		for(auto &[type, handlers] : receivers) {
+			for(Handler<GameEvent> *handler : handlers)
+				delete handler;
+		}
+	}
+	virtual void propagatedown(GameEvent const &event) {}
+	virtual void operator()(GameEvent const &event) override {
+		auto const it = receivers.find(event.type);
+		if(it != receivers.end()) {
+			for(Handler<GameEvent> *handler : it->second)
+				(*handler)(event);
+		}
+		if(event.propagation == Propagation::DOWN)
+			propagatedown(event);
+	}
+	template<typename Action>
+	void add(GameEventType type, Action action) {
+		receivers[type].insert(new Handler<GameEvent>(action));
+	}
+};
+
+template<typename Distributor>
+struct Node : Distributor {
+	vector<unique_ptr<Node>> children;
+	virtual void propagatedown(GameEvent const &event) override {
+		for(unique_ptr<Node> const &child : children)
+			(*child)(event);
+	}
+};
+
+template<typename Distributor>
+void run(char const *name) {
+	Node<Distributor> root;
+	unsigned long long count = 0;
+	for(unsigned i = 0; i < 1000; ++i) {
+		auto entity = make_unique<Node<Distributor>>();
+		for(unsigned j = 0; j < 100; ++j) {
+			auto component = make_unique<Node<Distributor>>();
+			component->add(GameEventType::UPDATE, [&count](GameEvent const &) { ++count; });
+			for(GameEventType type : { GameEventType::ACTIVATE, GameEventType::INACTIVATE, GameEventType::TRANSFORM, GameEventType::PAINT })
+				component->add(type, [](GameEvent const &) {});
+			entity->children.push_back(move(component));
+		}
+		root.children.push_back(move(entity));
+	}
+	double const update = measure([&]() { root({ GameEventType::UPDATE, Propagation::DOWN }); });
+	double const unheard = measure([&]() { root({ GameEventType::MOUSEDOWN, Propagation::DOWN }); });
+	printf("%s: UPDATE %.2f ms, unheard MOUSEDOWN %.2f ms (%llu handler calls)\n", name, update, unheard, count);
+}
+
+int main() {
+	run<MapDistributor>("map of sets");
+	run<EventDistributor<GameEvent>>("handler table");
+}
@@ -0,0 +1,28 @@
+// Camera paints of one 1024x1024 sprite turned to several angles, drawn
+// about one texel per pixel, from a linear bitmap and from a tiled one.
+// Rows of the linear bitmap are walked across at every angle but 0.
+
+#include "bench.hpp"
+#include "scene.hpp"
+#include <numbers>
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineBench;
+
+int main() {
+	Bitmap const linear = gradient(1024);
+	Bitmap const tiled = linear.relayout(Layout::TILED);
+	SpriteScene s(Vec2U{ 1280, 720 });
+	s.addsprites(linear, 1, 1, Vec2F{ 0, 0 }, 1.f / 14);
+	s.start();
+	WorldEntity *const sprite = s.sprites[0];
+	Sprite *const texture = sprite->getcomponent<Sprite>();
+	for(int degrees : { 0, 30, 45, 90 }) {
+		sprite->transform.rotation = degrees * numbers::pi_v<float> / 180;
+		texture->setbitmap(linear);
+		double const l = measure([&]() { s.paint(); });
+		texture->setbitmap(tiled);
+		double const t = measure([&]() { s.paint(); });
+		printf("%d degrees: %.2f ms linear, %.2f ms tiled\n", degrees, l, t);
+	}
+}
@@ -0,0 +1,49 @@
+// Nanoseconds per Matrix::compose and Matrix::operator() call on 4x4
+// and 3x3 float matrices, which Camera makes per texture and per pixel.
+// The program sticks to what the original virtual _Vector types offered,
+// so it also compiles against the first linear.hpp for the old numbers.
+
+#include "bench.hpp"
+#include "../linear.hpp"
+#include <cmath>
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineBench;
+
+// A rotation about the last axis; repeated products of it stay bounded.
+template<unsigned D>
+Matrix<D, D, float> rotation(float angle) {
+	Matrix<D, D, float> res;
+	for(unsigned i = 0; i < D; ++i)
+		res.data[i * (D + 1)] = 1;
+	res.data[0] = res.data[D + 1] = cos(angle);
+	res.data[1] = -sin(angle);
+	res.data[D] = sin(angle);
+	return res;
+}
+
+template<unsigned D>
+void run() {
+	constexpr unsigned count = 100000;
+	Matrix<D, D, float> m = rotation<D>(.1f);
+	Matrix<D, D, float> const step = rotation<D>(.01f);
+	Vector<D, float> v;
+	for(unsigned i = 0; i < D; ++i)
+		v[i] = (float)i + 1;
+	double const compose = measure([&]() {
+		for(unsigned i = 0; i < count; ++i)
+			m = m.compose(step);
+		sink = m.data[0];
+	});
+	double const apply = measure([&]() {
+		for(unsigned i = 0; i < count; ++i)
+			v = step(v);
+		sink = v[0];
+	});
+	printf("%ux%u: compose %.2f ns, operator() %.2f ns\n", D, D, compose * 1e6 / count, apply * 1e6 / count);
+}
+
+int main() {
+	run<4>();
+	run<3>();
+}
@@ -0,0 +1,21 @@
+// Camera paints of 300 rotated, overlapping sprites, the outer columns
+// of them partly or wholly off screen, with the scanline rasterizer and
+// with the per-pixel walk it replaced as the default.
+
+#include "bench.hpp"
+#include "scene.hpp"
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineBench;
+
+int main() {
+	SpriteScene s(Vec2U{ 1280, 720 });
+	s.addsprites(gradient(64), 300, 30, Vec2F{ .4f, .5f }, .01f);
+	s.start();
+	Camera &c = s.camera->camera;
+	c.rasterization = Camera::Rasterization::PIXELWISE;
+	double const pixelwise = measure([&]() { s.paint(); });
+	c.rasterization = Camera::Rasterization::SCANLINE;
+	double const scanline = measure([&]() { s.paint(); });
+	printf("paint: %.2f ms pixelwise, %.2f ms scanline\n", pixelwise, scanline);
+}
@@ -0,0 +1,47 @@
+// Keeping 20000 entities in depth order from frame to frame with
+// RenderList, against sorting them from scratch each frame as renderers
+// used to (with a plain key comparison rather than the virtual compare).
+
+#include "bench.hpp"
+#include "../renderlist.hpp"
+#include <algorithm>
+#include <random>
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineBench;
+
+int main() {
+	constexpr unsigned count = 20000;
+	mt19937 random(2022);
+	uniform_real_distribution<float> depth(-100, 100);
+	// Stand-ins for entities; RenderList only keys on the pointers.
+	vector<char> storage(count);
+	vector<Entity *> entities(count);
+	vector<float> keys(count);
+	RenderList list;
+	for(unsigned i = 0; i < count; ++i) {
+		entities[i] = (Entity *)(storage.data() + i);
+		keys[i] = depth(random);
+		list.update(entities[i], keys[i]);
+	}
+	list.entities();
+	vector<pair<float, Entity *>> queue;
+	double const sorted = measure([&]() {
+		queue.clear();
+		for(unsigned i = 0; i < count; ++i)
+			queue.emplace_back(keys[i], entities[i]);
+		sort(queue.begin(), queue.end(), [](auto const &a, auto const &b) { return a.first < b.first; });
+		sink = queue[0].first;
+	});
+	printf("std::sort each frame: %.3f ms\n", sorted);
+	for(unsigned changed : { 0U, 10U, 100U, 1000U, count }) {
+		double const kept = measure([&]() {
+			for(unsigned i = 0; i < changed; ++i) {
+				unsigned const at = random() % count;
+				list.update(entities[at], keys[at] = depth(random));
+			}
+			sink = (float)list.entities().size();
+		});
+		printf("RenderList, %u keys changed: %.3f ms\n", changed, kept);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// A camera over a grid of sprites in a window that is never shown, for
+// the programs here and in tests/ that paint a world scene.
+
+#include "../game.hpp"
+
+namespace Win32GameEngineBench {
+	using namespace Win32GameEngine;
+
+	// A square bitmap shading from black to red across and to green down,
+	// opaque or with alpha rising towards the bottom right corner.
+	inline Bitmap gradient(unsigned size, bool translucent = false) {
+		Bitmap res(Vec2U{ size, size });
+		for(unsigned y = 0; y < size; ++y) {
+			for(unsigned x = 0; x < size; ++x) {
+				unsigned char const alpha = translucent ? (unsigned char)((x + y) * 255 / (2 * size)) : 255;
+				res.data.get()[res.locate(x, y)] = Color(x * 256 / size, y * 256 / size, 128, alpha).premultiply();
+			}
+		}
+		return res;
+	}
+
+	struct SpriteScene {
+		Window window;
+		Game game;
+		Scene *const scene;
+		CameraEntity *const camera;
+		vector<WorldEntity *> sprites;
+		// A camera at z -10 seeing `view_size` world units across the
+		// diagonal of a `size` buffer.
+		SpriteScene(Vec2U size, float view_size = 10) :
+			window(Window::InitArg{ .size = size }),
+			game(&window),
+			scene(game.makescene()),
+			camera(new CameraEntity(scene, view_size)) {
+			camera->transform.position = Vec3F{ 0, 0, -10 };
+		}
+		// Adds `count` sprites of `bitmap` scaled by `scale`, centered on
+		// a grid `columns` wide with cells `spacing` apart, each turned a
+		// tenth of a radian more and lying a hundredth further back than
+		// the one before.
+		void addsprites(Bitmap const &bitmap, unsigned count, unsigned columns, Vec2F spacing, float scale) {
+			unsigned const rows = (count + columns - 1) / columns;
+			for(unsigned i = 0; i < count; ++i) {
+				WorldEntity *const e = new WorldEntity(scene);
+				e->makecomponent<Sprite>(bitmap);
+				e->transform.position = Vec3F{
+					((float)(i % columns) - columns / 2) * spacing[0],
+					((float)(i / columns) - rows / 2) * spacing[1],
+					(float)i / 100
+				};
+				e->transform.rotation = i * .1f;
+				e->transform.scale = Vec3F{ scale, scale, 1 };
+				sprites.push_back(e);
+			}
+		}
+		inline void start() {
+			scene->activate();
+			game.activate();
+		}
+		// Paints through the game's PAINT and POSTPAINT; with `redraw`,
+		// the camera draws its whole buffer rather than what changed.
+		void paint(bool redraw = true) {
+			if(redraw)
+				camera->camera.invalidate();
+			game({ GameEventType::PAINT, Propagation::DOWN });
+			game({ GameEventType::POSTPAINT, Propagation::DOWN });
+		}
+	};
+}
@@ -0,0 +1,24 @@
+// Scaling of tiled rasterization with the thread count: camera paints
+// of 300 rotated, overlapping sprites on a 1920x1080 buffer, serial
+// scanline first, then tiled with 1 to hardware_concurrency() threads.
+
+#include "bench.hpp"
+#include "scene.hpp"
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineBench;
+
+int main() {
+	SpriteScene s(Vec2U{ 1920, 1080 });
+	s.addsprites(gradient(64, true), 300, 30, Vec2F{ .3f, .45f }, .015f);
+	s.start();
+	Camera &c = s.camera->camera;
+	double const serial = measure([&]() { s.paint(); });
+	printf("scanline: %.2f ms\n", serial);
+	c.rasterization = Camera::Rasterization::TILED;
+	for(unsigned threads = 1, n = std::max(1U, thread::hardware_concurrency()); threads <= n; ++threads) {
+		c.setthreads(threads);
+		double const tiled = measure([&]() { s.paint(); });
+		printf("tiled, %u threads: %.2f ms, %.2fx\n", threads, tiled, serial / tiled);
+	}
+}
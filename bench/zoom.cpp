@@ -0,0 +1,26 @@
+// Camera paints of one 2048x2048 sprite as the view zooms out, sampling
+// the full-size bitmap only and then the mip level matching each zoom.
+
+#include "bench.hpp"
+#include "scene.hpp"
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineBench;
+
+int main() {
+	SpriteScene s(Vec2U{ 1280, 720 });
+	Bitmap image = gradient(2048);
+	image.buildmips();
+	s.addsprites(image, 1, 1, Vec2F{ 0, 0 }, 1.f / 256);
+	s.sprites[0]->transform.rotation = .3f;
+	s.start();
+	Camera &c = s.camera->camera;
+	for(float view_size : { 2.f, 5.f, 10.f, 20.f, 40.f, 80.f, 160.f }) {
+		c.setviewsize(view_size);
+		c.mipmapping = false;
+		double const full = measure([&]() { s.paint(); });
+		c.mipmapping = true;
+		double const mipmapped = measure([&]() { s.paint(); });
+		printf("view size %g: %.2f ms full size, %.2f ms mipmapped\n", view_size, full, mipmapped);
+	}
+}
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "utils.hpp"
+#include <bit>
+#include <span>
+#include <atomic>
+#include <chrono>
 
 namespace Win32GameEngine {
 	template<typename Index>
@@ -15,7 +19,7 @@ namespace Win32GameEngine {
 		shared_ptr<Data> const data;
 		Buffer(unsigned size, Data *const data) : size(size), data(data) {}
 		Buffer(unsigned size, shared_ptr<Data> data) : size(size), data(data) {}
-		Buffer(unsigned size) : Buffer(size, new Data[size]) {}
+		Buffer(unsigned size) : Buffer(size, shared_ptr<Data>(new Data[size], default_delete<Data[]>())) {}
 		Buffer(Buffer<Data, Index> const &buffer) : Buffer(buffer.size, buffer.data) {}
 		virtual unsigned locate(Index index) const = 0;
 		virtual bool valid(Index const index) const = 0;
@@ -44,17 +48,569 @@ namespace Win32GameEngine {
 		inline Vec4F unify() const {
 			return Vec4F(Vector<4, Channel>{r, g, b, a}) * (1.f / 256);
 		}
-		Color operator+(Color const &c) {
+		// Straight-alpha "over": `c` composited over this color, in integer
+		// math with round-to-nearest. Differs from the former float version,
+		// which truncated, by at most 2 per color channel and 1 for alpha.
+		Color operator+(Color const &c) const {
 			if(c.a == 255)
 				return c;
-			Vec4F sf = unify(), cf = c.unify();
-			float _a = 1 - (1 - cf[3]) * (1 - sf[3]);
-			Vec3F rgb = sf * ((1 - cf[3]) * sf[3]) + cf * cf[3];
-			rgb = rgb * (1 / _a);
-			Vector<3, Channel> res = rgb * 256;
-			return Color(res[0], res[1], res[2], Channel(_a * 256));
+			if(c.a == 0)
+				return *this;
+			// Weights scaled by 255 * 255.
+			unsigned const
+				wc = c.a * 255U,
+				wd = a * (255U - c.a),
+				w = wc + wd,
+				half = w >> 1;
+			return Color(
+				Channel((c.r * wc + r * wd + half) / w),
+				Channel((c.g * wc + g * wd + half) / w),
+				Channel((c.b * wc + b * wd + half) / w),
+				Channel((w + 127) / 255)
+			);
+		}
+		// x / 255 rounded to nearest, for x <= 255 * 255.
+		static inline unsigned div255(unsigned x) {
+			x += 128;
+			return (x + (x >> 8)) >> 8;
+		}
+		Color premultiply() const {
+			return Color(
+				Channel(div255(r * a)),
+				Channel(div255(g * a)),
+				Channel(div255(b * a)),
+				a
+			);
+		}
+		Color unpremultiply() const {
+			if(a == 0)
+				return Color();
+			unsigned const half = a >> 1;
+			return Color(
+				Channel(std::min(255U, (r * 255U + half) / a)),
+				Channel(std::min(255U, (g * 255U + half) / a)),
+				Channel(std::min(255U, (b * 255U + half) / a)),
+				a
+			);
+		}
+		// Premultiplied-alpha "over": `c` composited over this color.
+		// Takes no division, unlike the straight operator+.
+		Color composite(Color const &c) const {
+			unsigned const t = 255U - c.a;
+			return Color(
+				Channel(std::min(255U, c.r + div255(r * t))),
+				Channel(std::min(255U, c.g + div255(g * t))),
+				Channel(std::min(255U, c.b + div255(b * t))),
+				Channel(std::min(255U, c.a + div255(a * t)))
+			);
+		}
+	};
+	static_assert(sizeof(Color) == 4);
+
+	// How a bitmap's color channels relate to its alpha. The engine
+	// renders in PREMULTIPLIED, which is also what GDI's AlphaBlend
+	// expects with AC_SRC_ALPHA.
+	enum class PixelFormat {
+		STRAIGHT,
+		PREMULTIPLIED
+	};
+
+	// How a bitmap's pixels are ordered in memory. LINEAR is row by row,
+	// as GDI wants it. TILED stores 8x8 tiles row by row, each tile row
+	// by row, with the size padded to whole tiles; samples walking the
+	// bitmap in any direction stay within few cache lines.
+	enum class Layout {
+		LINEAR,
+		TILED
+	};
+
+	// Alpha coverage of a group of pixels.
+	enum class Opacity {
+		// Every pixel has zero alpha.
+		CLEAR,
+		// Every pixel has full alpha.
+		SOLID,
+		// Anything else.
+		MIXED
+	};
+	inline Opacity opacityof(Color const &c) {
+		return c.a == 0 ? Opacity::CLEAR : c.a == 255 ? Opacity::SOLID : Opacity::MIXED;
+	}
+	// Opacity of the union of two groups.
+	inline Opacity operator|(Opacity a, Opacity b) {
+		return a == b ? a : Opacity::MIXED;
+	}
+
+	// Converts `count` pixels between pixel formats; `dest` may be `src`.
+	inline void convert(Color *dest, Color const *src, unsigned count, PixelFormat from, PixelFormat to) {
+		if(from == to) {
+			if(dest != src)
+				copy(src, src + count, dest);
+			return;
+		}
+		if(to == PixelFormat::PREMULTIPLIED) {
+			unsigned i = 0;
+#if defined(WIN32GE_SSE2)
+			// c * a / 255 on 16-bit lanes, rounded as Color::div255().
+			__m128i const
+				alpha = _mm_set1_epi32((int)0xFF000000),
+				zero = _mm_setzero_si128(),
+				round = _mm_set1_epi16(128);
+			for(; i + 4 <= count; i += 4) {
+				__m128i const s = _mm_loadu_si128((__m128i const *)(src + i));
+				if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha), alpha)) == 0xFFFF) {
+					_mm_storeu_si128((__m128i *)(dest + i), s);
+					continue;
+				}
+				__m128i res[2];
+				for(unsigned h = 0; h < 2; ++h) {
+					__m128i const
+						s16 = h ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero),
+						a16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xFF), 0xFF);
+					__m128i const x = _mm_add_epi16(_mm_mullo_epi16(s16, a16), round);
+					res[h] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+				}
+				_mm_storeu_si128((__m128i *)(dest + i), _mm_or_si128(
+					_mm_andnot_si128(alpha, _mm_packus_epi16(res[0], res[1])),
+					_mm_and_si128(s, alpha)
+				));
+			}
+#endif
+			for(; i < count; ++i)
+				dest[i] = src[i].premultiply();
+		}
+		else {
+			for(unsigned i = 0; i < count; ++i)
+				dest[i] = src[i].unpremultiply();
+		}
+	}
+
+	// Row converters from packed file pixels to Color, for image loading.
+
+	// 24-bit BGR to opaque pixels.
+	inline void expandbgr(Color *dest, unsigned char const *src, unsigned count) {
+		unsigned i = 0;
+#if defined(WIN32GE_AVX)
+		{
+			__m128i const
+				shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1),
+				alpha = _mm_set1_epi32((int)0xFF000000);
+			// Each load reads 16 bytes for 4 pixels' 12, so it stops short
+			// of the row's end.
+			for(; i + 6 <= count; i += 4) {
+				__m128i const s = _mm_loadu_si128((__m128i const *)(src + i * 3));
+				_mm_storeu_si128((__m128i *)(dest + i), _mm_or_si128(_mm_shuffle_epi8(s, shuffle), alpha));
+			}
+		}
+#endif
+		for(; i < count; ++i)
+			dest[i] = Color(src[i * 3 + 2], src[i * 3 + 1], src[i * 3]);
+	}
+	// 32-bit pixels with red and blue in each other's place, as RGBA
+	// bytes, with alpha forced to 255 if `opaque`. `dest` may be `src`.
+	inline void swapredblue(Color *dest, unsigned char const *src, unsigned count, bool opaque) {
+		unsigned i = 0;
+		unsigned const fill = opaque ? 0xFF000000 : 0;
+#if defined(WIN32GE_AVX2)
+		{
+			__m256i const
+				keep = _mm256_set1_epi32((int)0xFF00FF00),
+				low = _mm256_set1_epi32(0xFF),
+				alpha = _mm256_set1_epi32((int)fill);
+			for(; i + 8 <= count; i += 8) {
+				__m256i const s = _mm256_loadu_si256((__m256i const *)(src + i * 4));
+				_mm256_storeu_si256((__m256i *)(dest + i), _mm256_or_si256(
+					_mm256_or_si256(_mm256_and_si256(s, keep), alpha),
+					_mm256_or_si256(
+						_mm256_and_si256(_mm256_srli_epi32(s, 16), low),
+						_mm256_slli_epi32(_mm256_and_si256(s, low), 16)
+					)
+				));
+			}
+		}
+#endif
+#if defined(WIN32GE_SSE2)
+		{
+			__m128i const
+				keep = _mm_set1_epi32((int)0xFF00FF00),
+				low = _mm_set1_epi32(0xFF),
+				alpha = _mm_set1_epi32((int)fill);
+			for(; i + 4 <= count; i += 4) {
+				__m128i const s = _mm_loadu_si128((__m128i const *)(src + i * 4));
+				_mm_storeu_si128((__m128i *)(dest + i), _mm_or_si128(
+					_mm_or_si128(_mm_and_si128(s, keep), alpha),
+					_mm_or_si128(
+						_mm_and_si128(_mm_srli_epi32(s, 16), low),
+						_mm_slli_epi32(_mm_and_si128(s, low), 16)
+					)
+				));
+			}
+		}
+#endif
+		for(; i < count; ++i) {
+			unsigned char const *const p = src + i * 4;
+			dest[i] = Color(p[0], p[1], p[2], opaque ? 255 : p[3]);
+		}
+	}
+	// 32-bit BGRA pixels, with alpha forced to 255 if `opaque`. `dest` may
+	// be `src`.
+	inline void copybgra(Color *dest, unsigned char const *src, unsigned count, bool opaque) {
+		if(!opaque) {
+			memmove(dest, src, count * sizeof(Color));
+			return;
+		}
+		unsigned i = 0;
+#if defined(WIN32GE_AVX2)
+		{
+			__m256i const alpha = _mm256_set1_epi32((int)0xFF000000);
+			for(; i + 8 <= count; i += 8) {
+				__m256i const s = _mm256_loadu_si256((__m256i const *)(src + i * 4));
+				_mm256_storeu_si256((__m256i *)(dest + i), _mm256_or_si256(s, alpha));
+			}
+		}
+#endif
+#if defined(WIN32GE_SSE2)
+		{
+			__m128i const alpha = _mm_set1_epi32((int)0xFF000000);
+			for(; i + 4 <= count; i += 4) {
+				__m128i const s = _mm_loadu_si128((__m128i const *)(src + i * 4));
+				_mm_storeu_si128((__m128i *)(dest + i), _mm_or_si128(s, alpha));
+			}
+		}
+#endif
+		for(; i < count; ++i) {
+			unsigned char const *const p = src + i * 4;
+			dest[i] = Color(p[2], p[1], p[0], 255);
+		}
+	}
+
+	// Composites `count` source pixels over the destination pixels, with
+	// the same result as `dest[i] = dest[i] + src[i]`. Runs of fully opaque
+	// or fully transparent sources are copied or skipped outright, and
+	// sources over an opaque destination are blended a register at a time.
+	inline void blend(Color *dest, Color const *src, unsigned count) {
+		unsigned i = 0;
+#if defined(WIN32GE_AVX2)
+		{
+			__m256i const
+				alpha = _mm256_set1_epi32((int)0xFF000000),
+				zero = _mm256_setzero_si256(),
+				max = _mm256_set1_epi16(255),
+				round = _mm256_set1_epi16(128);
+			for(; i + 8 <= count; i += 8) {
+				__m256i const s = _mm256_loadu_si256((__m256i const *)(src + i));
+				__m256i const sa = _mm256_and_si256(s, alpha);
+				if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) == -1)
+					continue;
+				if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, alpha)) == -1) {
+					_mm256_storeu_si256((__m256i *)(dest + i), s);
+					continue;
+				}
+				__m256i const d = _mm256_loadu_si256((__m256i const *)(dest + i));
+				if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(d, alpha), alpha)) != -1) {
+					for(unsigned j = i; j < i + 8; ++j)
+						dest[j] = dest[j] + src[j];
+					continue;
+				}
+				// (s * a + d * (255 - a)) / 255 on 16-bit lanes, two halves.
+				__m256i res[2];
+				for(unsigned h = 0; h < 2; ++h) {
+					__m256i const
+						s16 = h ? _mm256_unpackhi_epi8(s, zero) : _mm256_unpacklo_epi8(s, zero),
+						d16 = h ? _mm256_unpackhi_epi8(d, zero) : _mm256_unpacklo_epi8(d, zero),
+						a16 = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s16, 0xFF), 0xFF);
+					__m256i x = _mm256_add_epi16(
+						_mm256_add_epi16(
+							_mm256_mullo_epi16(s16, a16),
+							_mm256_mullo_epi16(d16, _mm256_sub_epi16(max, a16))
+						),
+						round
+					);
+					res[h] = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+				}
+				_mm256_storeu_si256(
+					(__m256i *)(dest + i),
+					_mm256_or_si256(_mm256_packus_epi16(res[0], res[1]), alpha)
+				);
+			}
+		}
+#endif
+#if defined(WIN32GE_SSE2)
+		{
+			__m128i const
+				alpha = _mm_set1_epi32((int)0xFF000000),
+				zero = _mm_setzero_si128(),
+				max = _mm_set1_epi16(255),
+				round = _mm_set1_epi16(128);
+			for(; i + 4 <= count; i += 4) {
+				__m128i const s = _mm_loadu_si128((__m128i const *)(src + i));
+				__m128i const sa = _mm_and_si128(s, alpha);
+				if(_mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) == 0xFFFF)
+					continue;
+				if(_mm_movemask_epi8(_mm_cmpeq_epi32(sa, alpha)) == 0xFFFF) {
+					_mm_storeu_si128((__m128i *)(dest + i), s);
+					continue;
+				}
+				__m128i const d = _mm_loadu_si128((__m128i const *)(dest + i));
+				if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(d, alpha), alpha)) != 0xFFFF) {
+					for(unsigned j = i; j < i + 4; ++j)
+						dest[j] = dest[j] + src[j];
+					continue;
+				}
+				__m128i res[2];
+				for(unsigned h = 0; h < 2; ++h) {
+					__m128i const
+						s16 = h ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero),
+						d16 = h ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero),
+						a16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xFF), 0xFF);
+					__m128i x = _mm_add_epi16(
+						_mm_add_epi16(
+							_mm_mullo_epi16(s16, a16),
+							_mm_mullo_epi16(d16, _mm_sub_epi16(max, a16))
+						),
+						round
+					);
+					res[h] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+				}
+				_mm_storeu_si128((__m128i *)(dest + i), _mm_or_si128(_mm_packus_epi16(res[0], res[1]), alpha));
+			}
+		}
+#endif
+		for(; i < count; ++i)
+			dest[i] = dest[i] + src[i];
+	}
+
+	// Premultiplied counterpart of blend(): `dest[i] = dest[i].composite(src[i])`.
+	// Each channel is s + d * (255 - a) / 255, so every group of pixels is
+	// blended a register at a time whatever the destination holds.
+	inline void blendpremultiplied(Color *dest, Color const *src, unsigned count) {
+		unsigned i = 0;
+#if defined(WIN32GE_AVX2)
+		{
+			__m256i const
+				alpha = _mm256_set1_epi32((int)0xFF000000),
+				zero = _mm256_setzero_si256(),
+				max = _mm256_set1_epi16(255),
+				round = _mm256_set1_epi16(128);
+			for(; i + 8 <= count; i += 8) {
+				__m256i const s = _mm256_loadu_si256((__m256i const *)(src + i));
+				__m256i const sa = _mm256_and_si256(s, alpha);
+				if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) == -1)
+					continue;
+				if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, alpha)) == -1) {
+					_mm256_storeu_si256((__m256i *)(dest + i), s);
+					continue;
+				}
+				__m256i const d = _mm256_loadu_si256((__m256i const *)(dest + i));
+				__m256i res[2];
+				for(unsigned h = 0; h < 2; ++h) {
+					__m256i const
+						s16 = h ? _mm256_unpackhi_epi8(s, zero) : _mm256_unpacklo_epi8(s, zero),
+						d16 = h ? _mm256_unpackhi_epi8(d, zero) : _mm256_unpacklo_epi8(d, zero),
+						a16 = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s16, 0xFF), 0xFF);
+					__m256i const x = _mm256_add_epi16(_mm256_mullo_epi16(d16, _mm256_sub_epi16(max, a16)), round);
+					res[h] = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+				}
+				_mm256_storeu_si256(
+					(__m256i *)(dest + i),
+					_mm256_adds_epu8(_mm256_packus_epi16(res[0], res[1]), s)
+				);
+			}
+		}
+#endif
+#if defined(WIN32GE_SSE2)
+		{
+			__m128i const
+				alpha = _mm_set1_epi32((int)0xFF000000),
+				zero = _mm_setzero_si128(),
+				max = _mm_set1_epi16(255),
+				round = _mm_set1_epi16(128);
+			for(; i + 4 <= count; i += 4) {
+				__m128i const s = _mm_loadu_si128((__m128i const *)(src + i));
+				__m128i const sa = _mm_and_si128(s, alpha);
+				if(_mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) == 0xFFFF)
+					continue;
+				if(_mm_movemask_epi8(_mm_cmpeq_epi32(sa, alpha)) == 0xFFFF) {
+					_mm_storeu_si128((__m128i *)(dest + i), s);
+					continue;
+				}
+				__m128i const d = _mm_loadu_si128((__m128i const *)(dest + i));
+				__m128i res[2];
+				for(unsigned h = 0; h < 2; ++h) {
+					__m128i const
+						s16 = h ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero),
+						d16 = h ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero),
+						a16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xFF), 0xFF);
+					__m128i const x = _mm_add_epi16(_mm_mullo_epi16(d16, _mm_sub_epi16(max, a16)), round);
+					res[h] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+				}
+				_mm_storeu_si128((__m128i *)(dest + i), _mm_adds_epu8(_mm_packus_epi16(res[0], res[1]), s));
+			}
+		}
+#endif
+		for(; i < count; ++i) {
+			if(src[i].a)
+				dest[i] = dest[i].composite(src[i]);
+		}
+	}
+
+	// Composites `count` source pixels under the destination pixels, i.e.
+	// `dest[i] = src[i].composite(dest[i])`, both premultiplied. Groups of
+	// already opaque destination pixels are left untouched. Returns how
+	// many destination pixels became opaque.
+	inline unsigned blendunder(Color *dest, Color const *src, unsigned count) {
+		unsigned i = 0, covered = 0;
+#if defined(WIN32GE_AVX2)
+		{
+			__m256i const
+				alpha = _mm256_set1_epi32((int)0xFF000000),
+				zero = _mm256_setzero_si256(),
+				max = _mm256_set1_epi16(255),
+				round = _mm256_set1_epi16(128);
+			for(; i + 8 <= count; i += 8) {
+				__m256i const d = _mm256_loadu_si256((__m256i const *)(dest + i));
+				int const before = _mm256_movemask_ps(_mm256_castsi256_ps(
+					_mm256_cmpeq_epi32(_mm256_and_si256(d, alpha), alpha)
+				));
+				if(before == 0xFF)
+					continue;
+				__m256i const s = _mm256_loadu_si256((__m256i const *)(src + i));
+				if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alpha), zero)) == -1)
+					continue;
+				__m256i res[2];
+				for(unsigned h = 0; h < 2; ++h) {
+					__m256i const
+						s16 = h ? _mm256_unpackhi_epi8(s, zero) : _mm256_unpacklo_epi8(s, zero),
+						d16 = h ? _mm256_unpackhi_epi8(d, zero) : _mm256_unpacklo_epi8(d, zero),
+						a16 = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(d16, 0xFF), 0xFF);
+					__m256i const x = _mm256_add_epi16(_mm256_mullo_epi16(s16, _mm256_sub_epi16(max, a16)), round);
+					res[h] = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+				}
+				__m256i const r = _mm256_adds_epu8(_mm256_packus_epi16(res[0], res[1]), d);
+				_mm256_storeu_si256((__m256i *)(dest + i), r);
+				int const after = _mm256_movemask_ps(_mm256_castsi256_ps(
+					_mm256_cmpeq_epi32(_mm256_and_si256(r, alpha), alpha)
+				));
+				covered += popcount((unsigned)(after & ~before));
+			}
+		}
+#endif
+#if defined(WIN32GE_SSE2)
+		{
+			__m128i const
+				alpha = _mm_set1_epi32((int)0xFF000000),
+				zero = _mm_setzero_si128(),
+				max = _mm_set1_epi16(255),
+				round = _mm_set1_epi16(128);
+			for(; i + 4 <= count; i += 4) {
+				__m128i const d = _mm_loadu_si128((__m128i const *)(dest + i));
+				int const before = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(d, alpha), alpha)));
+				if(before == 0xF)
+					continue;
+				__m128i const s = _mm_loadu_si128((__m128i const *)(src + i));
+				if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha), zero)) == 0xFFFF)
+					continue;
+				__m128i res[2];
+				for(unsigned h = 0; h < 2; ++h) {
+					__m128i const
+						s16 = h ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero),
+						d16 = h ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero),
+						a16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(d16, 0xFF), 0xFF);
+					__m128i const x = _mm_add_epi16(_mm_mullo_epi16(s16, _mm_sub_epi16(max, a16)), round);
+					res[h] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+				}
+				__m128i const r = _mm_adds_epu8(_mm_packus_epi16(res[0], res[1]), d);
+				_mm_storeu_si128((__m128i *)(dest + i), r);
+				int const after = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(r, alpha), alpha)));
+				covered += popcount((unsigned)(after & ~before));
+			}
+		}
+#endif
+		for(; i < count; ++i) {
+			Color &d = dest[i];
+			if(d.a == 255 || !src[i].a)
+				continue;
+			d = src[i].composite(d);
+			covered += d.a == 255;
+		}
+		return covered;
+	}
+
+	// A rectangle of pixels held elsewhere, rows `stride` pixels apart.
+	// Owns nothing and calls nothing virtual, so loops over its rows are
+	// plain pointer arithmetic the compiler can vectorize. A view of a
+	// Bitmap lives no longer than the bitmap's pixels.
+	template<typename Pixel>
+	struct BasicBitmapView {
+		Pixel *data;
+		unsigned width, height, stride;
+		BasicBitmapView() : data(nullptr), width(0), height(0), stride(0) {}
+		BasicBitmapView(Pixel *data, unsigned width, unsigned height, unsigned stride) :
+			data(data), width(width), height(height), stride(stride) {}
+		BasicBitmapView(Pixel *data, unsigned width, unsigned height) :
+			BasicBitmapView(data, width, height, width) {}
+		// Views of writable pixels pass as read-only ones.
+		template<typename P> requires is_convertible_v<P *, Pixel *>
+		BasicBitmapView(BasicBitmapView<P> const &v) :
+			BasicBitmapView(v.data, v.width, v.height, v.stride) {}
+		inline bool empty() const { return !width || !height; }
+		inline Pixel *row(unsigned y) const { return data + (size_t)y * stride; }
+		inline span<Pixel> operator[](unsigned y) const { return { row(y), width }; }
+		inline Pixel &operator()(unsigned x, unsigned y) const { return row(y)[x]; }
+		// The pixel at `p`, or null outside the view.
+		inline Pixel *at(Vec2I p) const {
+			return (unsigned)p[0] < width && (unsigned)p[1] < height ? row(p[1]) + p[0] : nullptr;
+		}
+		// The `size` pixels from `min`, which must lie within this view.
+		inline BasicBitmapView sub(Vec2U min, Vec2U size) const {
+			return { row(min[1]) + min[0], size[0], size[1], stride };
+		}
+		// Iterates over the rows as spans.
+		struct RowIterator {
+			Pixel *row;
+			unsigned width, stride;
+			inline span<Pixel> operator*() const { return { row, width }; }
+			inline RowIterator &operator++() {
+				row += stride;
+				return *this;
+			}
+			inline bool operator!=(RowIterator const &r) const { return row != r.row; }
+		};
+		inline RowIterator begin() const { return { data, width, stride }; }
+		inline RowIterator end() const { return { row(height), width, stride }; }
+		// Whether the rows follow each other with no gap, so the view can
+		// be handled as a single run of width * height pixels.
+		inline bool contiguous() const { return stride == width || height <= 1; }
+		void fill(Color c) const requires (!is_const_v<Pixel>) {
+			unsigned const w = contiguous() ? width * height : width, h = contiguous() ? !empty() : height;
+			bool const zero = !bit_cast<unsigned>(c);
+			for(unsigned y = 0; y < h; ++y) {
+				if(zero)
+					memset(row(y), 0, w * sizeof(Color));
+				else
+					fill_n(row(y), w, c);
+			}
+		}
+		// The overlap of both views' top-left corners, from `src`, which
+		// must not overlap this view.
+		void copy(BasicBitmapView<Color const> src) const requires (!is_const_v<Pixel>) {
+			unsigned const w = std::min(width, src.width), h = std::min(height, src.height);
+			if(w == width && w == src.width && contiguous() && src.contiguous()) {
+				memcpy(data, src.data, (size_t)w * h * sizeof(Color));
+				return;
+			}
+			for(unsigned y = 0; y < h; ++y)
+				memcpy(row(y), src.row(y), w * sizeof(Color));
+		}
+		// Same, compositing premultiplied `src` over this view.
+		void blit(BasicBitmapView<Color const> src) const requires (!is_const_v<Pixel>) {
+			unsigned const w = std::min(width, src.width), h = std::min(height, src.height);
+			for(unsigned y = 0; y < h; ++y)
+				blendpremultiplied(row(y), src.row(y), w);
 		}
 	};
+	using BitmapView = BasicBitmapView<Color>;
+	using ConstBitmapView = BasicBitmapView<Color const>;
 
 	struct Bitmap : Buffer<Color, Vec2I> {
 	protected:
@@ -62,50 +618,430 @@ namespace Win32GameEngine {
 		HDC hdc;
 	public:
 		Vec2U const dimension;
-		Bitmap(Vec2U dimension, shared_ptr<Color> data) : Buffer<Color, Vec2I>(dimension[0] * dimension[1], data),
+		PixelFormat const format;
+		Layout const layout;
+		// Pixels from one row to the next, a whole number of row_align.
+		unsigned const pitch;
+		static constexpr unsigned tile = 8;
+		// Rows are padded to a multiple of this many pixels, one AVX2
+		// register, so with 64-byte aligned storage every row starts
+		// aligned for SIMD. Also a multiple of `tile`, so a tiled bitmap
+		// has pitch / tile tiles per row.
+		static constexpr unsigned row_align = 8;
+		static inline unsigned pitchof(unsigned width) {
+			return (width + row_align - 1) / row_align * row_align;
+		}
+		// Pixels stored for a bitmap, padding included.
+		static inline unsigned storage(Vec2U dimension, Layout layout) {
+			if(layout == Layout::LINEAR)
+				return pitchof(dimension[0]) * dimension[1];
+			return pitchof(dimension[0]) * ((dimension[1] + tile - 1) / tile * tile);
+		}
+		// Pools the pixels of every bitmap.
+		static BufferPool &pool() {
+			static BufferPool res;
+			return res;
+		}
+		// Zeroed, 64-byte aligned storage for `count` pixels, handed back
+		// to the pool once no bitmap uses it.
+		static shared_ptr<Color> allocate(unsigned count) {
+			size_t const bytes = (size_t)count * sizeof(Color);
+			Color *const p = (Color *)pool().allocate(bytes);
+			memset(p, 0, bytes);
+			return shared_ptr<Color>(p, [bytes](Color *p) { pool().deallocate(p, bytes); });
+		}
+		Bitmap(
+			Vec2U dimension, shared_ptr<Color> data,
+			PixelFormat format = PixelFormat::PREMULTIPLIED,
+			Layout layout = Layout::LINEAR
+		) : Buffer<Color, Vec2I>(storage(dimension, layout), data),
 			dimension(dimension),
+			format(format),
+			layout(layout),
+			pitch(pitchof(dimension[0])),
 			handle(NULL),
-			hdc(NULL) {
+			hdc(NULL),
+			opacity(Opacity::MIXED) {
+		}
+		Bitmap(Vec2U dimension, PixelFormat format = PixelFormat::PREMULTIPLIED, Layout layout = Layout::LINEAR) :
+			Bitmap(dimension, allocate(storage(dimension, layout)), format, layout) {}
+		Bitmap(Bitmap const &bitmap) noexcept : Bitmap(bitmap.dimension, bitmap.data, bitmap.format, bitmap.layout) {
+			opacity = bitmap.opacity;
+			blocks = bitmap.blocks;
+			mips = bitmap.mips;
+		}
+		// This bitmap in the given format. Shares the pixels if the format
+		// already matches, otherwise converts them into a new bitmap.
+		Bitmap as(PixelFormat to) const {
+			if(to == format)
+				return *this;
+			Bitmap res(dimension, to, layout);
+			convert(res.data.get(), data.get(), size, format, to);
+			res.opacity = opacity;
+			res.blocks = blocks;
+			if(mips)
+				res.buildmips();
+			return res;
+		}
+		// This bitmap in the given layout. Shares the pixels if the layout
+		// already matches, otherwise reorders them into a new bitmap.
+		Bitmap relayout(Layout to) const {
+			if(to == layout)
+				return *this;
+			Bitmap res(dimension, format, to);
+			Color const *const src = data.get();
+			Color *const dest = res.data.get();
+			unsigned const w = dimension[0], h = dimension[1];
+			for(unsigned y = 0; y < h; ++y) {
+				for(unsigned x = 0; x < w; ++x)
+					dest[res.locate(x, y)] = src[locate(x, y)];
+			}
+			res.opacity = opacity;
+			res.blocks = blocks;
+			if(mips) {
+				auto levels = make_shared<vector<Bitmap>>();
+				levels->reserve(mips->size());
+				for(Bitmap const &level : *mips)
+					levels->push_back(level.relayout(to));
+				res.mips = levels;
+			}
+			return res;
+		}
+		// Index of the pixel at (x, y) of a bitmap of the given pitch in a
+		// given layout; (x, y) must be inside the bitmap. Loops hoist
+		// `pitch` into a local, so the tile math folds into shifts and masks.
+		template<Layout L>
+		static inline unsigned locate(unsigned x, unsigned y, unsigned pitch) {
+			if constexpr(L == Layout::LINEAR)
+				return y * pitch + x;
+			else
+				return ((y / tile * (pitch / tile) + x / tile) * tile + y % tile) * tile + x % tile;
+		}
+		template<Layout L>
+		inline unsigned locate(unsigned x, unsigned y) const {
+			return locate<L>(x, y, pitch);
+		}
+		inline unsigned locate(unsigned x, unsigned y) const {
+			return layout == Layout::LINEAR ? locate<Layout::LINEAR>(x, y) : locate<Layout::TILED>(x, y);
+		}
+		// The pixels as a view. Only linear bitmaps have one.
+		BitmapView view() {
+			if(layout != Layout::LINEAR)
+				throw L"Tiled bitmaps have no view.";
+			return { data.get(), dimension[0], dimension[1], pitch };
+		}
+		ConstBitmapView view() const {
+			return const_cast<Bitmap *>(this)->view();
+		}
+		// Opacity of the whole bitmap; MIXED until analyze() has run.
+		Opacity opacity;
+		// Opacity of each opacity_block-sized square, row by row.
+		shared_ptr<vector<Opacity>> blocks;
+		static constexpr unsigned opacity_block = 8;
+		// Opacity of one opacity block.
+		Opacity analyzeblock(unsigned bx, unsigned by) const {
+			unsigned const
+				w = dimension[0], h = dimension[1],
+				x0 = bx * opacity_block, x1 = std::min(x0 + opacity_block, w),
+				y0 = by * opacity_block, y1 = std::min(y0 + opacity_block, h);
+			Color const *const pixels = data.get();
+			Opacity block = opacityof(pixels[locate(x0, y0)]);
+			for(unsigned y = y0; y < y1 && block != Opacity::MIXED; ++y) {
+				for(unsigned x = x0; x < x1; ++x)
+					block = block | opacityof(pixels[locate(x, y)]);
+			}
+			return block;
+		}
+		// Computes the opacity metadata. Done once at load; bitmaps
+		// modified afterwards must call it again.
+		void analyze() {
+			unsigned const
+				w = dimension[0], h = dimension[1],
+				bw = (w + opacity_block - 1) / opacity_block,
+				bh = (h + opacity_block - 1) / opacity_block;
+			auto res = make_shared<vector<Opacity>>(bw * bh);
+			opacity = size ? opacityof(data.get()[0]) : Opacity::CLEAR;
+			blocks = res;
+			for(unsigned by = 0; by < bh; ++by) {
+				for(unsigned bx = 0; bx < bw; ++bx) {
+					Opacity const block = analyzeblock(bx, by);
+					(*res)[by * bw + bx] = block;
+					opacity = opacity | block;
+				}
+			}
+		}
+		// Recomputes the blocks over the pixels from `min` to `max`
+		// exclusive, in place, so copies sharing the blocks see the change.
+		void analyze(Vec2U min, Vec2U max) {
+			if(!blocks) {
+				analyze();
+				return;
+			}
+			unsigned const bw = (dimension[0] + opacity_block - 1) / opacity_block;
+			max = Vec2U{ std::min(max[0], dimension[0]), std::min(max[1], dimension[1]) };
+			if(min[0] >= max[0] || min[1] >= max[1])
+				return;
+			for(unsigned by = min[1] / opacity_block; by <= (max[1] - 1) / opacity_block; ++by) {
+				for(unsigned bx = min[0] / opacity_block; bx <= (max[0] - 1) / opacity_block; ++bx)
+					(*blocks)[by * bw + bx] = analyzeblock(bx, by);
+			}
+			opacity = (*blocks)[0];
+			for(Opacity const block : *blocks)
+				opacity = opacity | block;
+		}
+		// Levels 1 and up of the mip pyramid, if built; level 0 is the
+		// bitmap itself.
+		shared_ptr<vector<Bitmap>> mips;
+		// Builds the mip pyramid. Each level halves the previous one,
+		// rounding up, averaging each 2x2 square of texels, down to 1x1 or
+		// to `limit` levels past the bitmap itself. Meant for premultiplied
+		// bitmaps, where averaging does not bleed the color of transparent
+		// texels.
+		void buildmips(unsigned limit = UINT_MAX) {
+			if(layout != Layout::LINEAR) {
+				Bitmap linear = relayout(Layout::LINEAR);
+				linear.buildmips(limit);
+				auto res = make_shared<vector<Bitmap>>();
+				res->reserve(linear.mips->size());
+				for(Bitmap const &level : *linear.mips)
+					res->push_back(level.relayout(layout));
+				mips = res;
+				return;
+			}
+			auto res = make_shared<vector<Bitmap>>();
+			unsigned count = 0;
+			for(unsigned s = std::max(dimension[0], dimension[1]); s > 1 && count < limit; s = (s + 1) / 2)
+				++count;
+			res->reserve(count);
+			Bitmap const *prev = this;
+			for(unsigned l = 0; l < count; ++l) {
+				unsigned const
+					pw = prev->dimension[0], ph = prev->dimension[1], pp = prev->pitch,
+					w = std::max(1U, (pw + 1) / 2), h = std::max(1U, (ph + 1) / 2);
+				Bitmap next(Vec2U{ w, h }, format);
+				Color const *const src = prev->data.get();
+				Color *const dest = next.data.get();
+				for(unsigned y = 0; y < h; ++y) {
+					// Odd edges repeat their last row or column.
+					Color const
+						*const r0 = src + std::min(y * 2, ph - 1) * pp,
+						*const r1 = src + std::min(y * 2 + 1, ph - 1) * pp;
+					for(unsigned x = 0; x < w; ++x) {
+						unsigned const x0 = std::min(x * 2, pw - 1), x1 = std::min(x * 2 + 1, pw - 1);
+						Color const &a = r0[x0], &b = r0[x1], &c = r1[x0], &d = r1[x1];
+						dest[y * next.pitch + x] = Color(
+							Color::Channel((a.r + b.r + c.r + d.r + 2) >> 2),
+							Color::Channel((a.g + b.g + c.g + d.g + 2) >> 2),
+							Color::Channel((a.b + b.b + c.b + d.b + 2) >> 2),
+							Color::Channel((a.a + b.a + c.a + d.a + 2) >> 2)
+						);
+					}
+				}
+				res->push_back(next);
+				prev = &res->back();
+			}
+			mips = res;
+		}
+		inline unsigned levels() const { return mips ? 1 + (unsigned)mips->size() : 1; }
+		// A level of the mip pyramid, clamped to the smallest one.
+		inline Bitmap const &mip(unsigned level) const {
+			level = std::min(level, levels() - 1);
+			return level ? (*mips)[level - 1] : *this;
+		}
+		// Opacity of the pixels from `min` to `max` inclusive, at block
+		// granularity, so a SOLID or CLEAR answer is always exact.
+		Opacity getopacity(Vec2I min, Vec2I max) const {
+			if(!blocks)
+				return opacity;
+			int const w = dimension[0], h = dimension[1];
+			int const
+				x0 = std::max(min[0], 0), x1 = std::min(max[0], w - 1),
+				y0 = std::max(min[1], 0), y1 = std::min(max[1], h - 1);
+			if(x0 > x1 || y0 > y1)
+				return Opacity::CLEAR;
+			// Pixels outside the bitmap read as clear.
+			bool const outside = min[0] < 0 || min[1] < 0 || max[0] >= w || max[1] >= h;
+			unsigned const bw = (w + opacity_block - 1) / opacity_block;
+			Opacity res = outside ? Opacity::CLEAR : (*blocks)[y0 / opacity_block * bw + x0 / opacity_block];
+			for(unsigned by = y0 / opacity_block; by <= y1 / opacity_block && res != Opacity::MIXED; ++by) {
+				for(unsigned bx = x0 / opacity_block; bx <= x1 / opacity_block; ++bx)
+					res = res | (*blocks)[by * bw + bx];
+			}
+			return res;
 		}
-		Bitmap(Vec2U dimension) : Bitmap(dimension, shared_ptr<Color>(new Color[dimension[0] * dimension[1]])) {}
-		Bitmap(Bitmap const &bitmap) : Bitmap(bitmap.dimension, bitmap.data) {}
 		~Bitmap() {
 			handle && DeleteObject(handle);
 			hdc && DeleteDC(hdc);
 		}
-		static Bitmap fromfile(ConstString url) {
-			File file(url);
-			tagBITMAPFILEHEADER *header = (tagBITMAPFILEHEADER *)file.data;
-			tagBITMAPINFO *info = (tagBITMAPINFO *)(file.data + sizeof(tagBITMAPFILEHEADER));
-			Vec2U dimension{ (unsigned)info->bmiHeader.biWidth, (unsigned)info->bmiHeader.biHeight };
-			Bitmap bitmap(dimension);
-			Color *data = bitmap.data.get();
-			typename Color::Channel *start = file.data + header->bfOffBits;
-			switch(info->bmiHeader.biBitCount) {
-			case 32:
-				for(unsigned i = 0, o = 0; i < bitmap.size; ++i) {
-					o = i * 4;
-					data[i] = Color(start[o], start[o + 1], start[o + 2], start[o + 3]);
-					if(start[o + 3] != 255) {
-						int a = 1;
+		// Totals over every fromfile() call.
+		struct LoadStats {
+			atomic<unsigned long long> files, bytes, microseconds;
+			// Megabytes of file loaded per second.
+			inline double throughput() const {
+				unsigned long long const us = microseconds;
+				return us ? (double)bytes / us : 0;
+			}
+		};
+		static inline LoadStats load_stats;
+		// Loads a BMP file, converting its straight alpha to `format`, and
+		// optionally builds its mip pyramid. The file is mapped rather than
+		// read, and each row goes straight from the mapping into the pixels.
+		// Takes 16, 24 and 32-bit uncompressed images with any header
+		// version, stored bottom-up or top-down, with or without
+		// BI_BITFIELDS masks. 32-bit images without masks whose alpha bytes
+		// are all zero are taken as opaque, as most writers leave them so.
+		static Bitmap fromfile(
+			ConstString url,
+			PixelFormat format = PixelFormat::PREMULTIPLIED,
+			bool mipmapped = false
+		) {
+			auto const start = chrono::steady_clock::now();
+			MappedFile const file(url);
+			unsigned char const *const bytes = file.data;
+			// Little-endian field of `size` bytes.
+			auto read = [&](size_t offset, unsigned size) {
+				if(offset + size > file.size)
+					throw L"Truncated BMP file.";
+				unsigned res = 0;
+				for(unsigned i = 0; i < size; ++i)
+					res |= (unsigned)bytes[offset + i] << i * 8;
+				return res;
+			};
+			if(read(0, 2) != 0x4D42)
+				throw L"Not a BMP file.";
+			size_t const offset = read(10, 4);
+			unsigned const header = read(14, 4);
+			int width, height;
+			unsigned bits, compression = BI_RGB;
+			if(header == 12) {
+				// BITMAPCOREHEADER, always bottom-up.
+				width = (int)read(18, 2);
+				height = (int)read(20, 2);
+				bits = read(24, 2);
+			}
+			else if(header >= 40) {
+				width = (int)read(18, 4);
+				height = (int)read(22, 4);
+				bits = read(28, 2);
+				compression = read(30, 4);
+			}
+			else
+				throw L"Unrecognized BMP header.";
+			// Red, green, blue and alpha masks.
+			unsigned masks[4] = {};
+			// BI_ALPHABITFIELDS, which older SDKs leave undefined.
+			constexpr unsigned alphabitfields = 6;
+			bool const fields = compression == BI_BITFIELDS || compression == alphabitfields;
+			if(fields) {
+				// Right after a 40-byte header, or part of a longer one;
+				// the alpha mask only from version 3 on.
+				unsigned const n = compression == alphabitfields || header >= 56 ? 4 : 3;
+				for(unsigned i = 0; i < n; ++i)
+					masks[i] = read(54 + i * 4, 4);
+			}
+			else if(compression != BI_RGB)
+				throw L"Compressed BMP files are not supported.";
+			else if(bits == 16) {
+				masks[0] = 0x7C00;
+				masks[1] = 0x03E0;
+				masks[2] = 0x001F;
+			}
+			else if(bits == 32) {
+				masks[0] = 0xFF0000;
+				masks[1] = 0xFF00;
+				masks[2] = 0xFF;
+				masks[3] = 0xFF000000;
+			}
+			if(!(bits == 32 || bits == 16 || (bits == 24 && !fields)) || width <= 0 || !height)
+				throw L"Unrecognized BMP data layout.";
+			bool const topdown = height < 0;
+			unsigned const w = width, h = topdown ? -height : height;
+			size_t const stride = ((size_t)w * bits + 31) / 32 * 4;
+			if(offset + stride * h > file.size)
+				throw L"Truncated BMP file.";
+			unsigned char const *const pixels = bytes + offset;
+			// How rows are converted.
+			enum class Row { BGR, BGRA, RGBA, MASKED } row = Row::MASKED;
+			bool opaque = !masks[3];
+			if(bits == 24) {
+				row = Row::BGR;
+				opaque = true;
+			}
+			else if(bits == 32 && masks[1] == 0xFF00 && (masks[3] == 0xFF000000 || !masks[3])) {
+				if(masks[0] == 0xFF0000 && masks[2] == 0xFF)
+					row = Row::BGRA;
+				else if(masks[0] == 0xFF && masks[2] == 0xFF0000)
+					row = Row::RGBA;
+			}
+			if(bits == 32 && !fields) {
+				opaque = true;
+				for(unsigned y = 0; y < h && opaque; ++y) {
+					unsigned char const *const src = pixels + y * stride;
+					for(unsigned x = 0; x < w; ++x) {
+						if(src[x * 4 + 3]) {
+							opaque = false;
+							break;
+						}
 					}
 				}
-				break;
-			case 24:
-				for(unsigned i = 0, o = 0; i < bitmap.size; ++i) {
-					o = i * 3;
-					data[i] = Color(start[o], start[o + 1], start[o + 2]);
+			}
+			// Position and width of each mask, for the masked rows.
+			unsigned shifts[4], widths[4];
+			for(unsigned c = 0; c < 4; ++c) {
+				shifts[c] = masks[c] ? countr_zero(masks[c]) : 0;
+				widths[c] = popcount(masks[c]);
+			}
+			auto channel = [&](unsigned pixel, unsigned c) {
+				unsigned const v = (pixel & masks[c]) >> shifts[c], n = widths[c];
+				if(!n)
+					return (Color::Channel)0;
+				if(n >= 8)
+					return (Color::Channel)(v >> (n - 8));
+				unsigned const max = (1U << n) - 1;
+				return (Color::Channel)((v * 255 + max / 2) / max);
+			};
+			Bitmap res(Vec2U{ w, h }, format);
+			BitmapView const view = res.view();
+			for(unsigned y = 0; y < h; ++y) {
+				unsigned char const *const src = pixels + (topdown ? y : h - 1 - y) * stride;
+				Color *const dest = view.row(y);
+				switch(row) {
+				case Row::BGR:
+					expandbgr(dest, src, w);
+					break;
+				case Row::BGRA:
+					copybgra(dest, src, w, opaque);
+					break;
+				case Row::RGBA:
+					swapredblue(dest, src, w, opaque);
+					break;
+				default:
+					for(unsigned x = 0; x < w; ++x) {
+						unsigned const pixel = bits == 16
+							? src[x * 2] | src[x * 2 + 1] << 8
+							: src[x * 4] | src[x * 4 + 1] << 8 | src[x * 4 + 2] << 16 | (unsigned)src[x * 4 + 3] << 24;
+						dest[x] = Color(channel(pixel, 0), channel(pixel, 1), channel(pixel, 2), opaque ? 255 : channel(pixel, 3));
+					}
 				}
-				break;
-			default:
-				throw L"Unrecognized BMP data layout.";
+				// Converted while the row is in cache.
+				if(!opaque)
+					convert(dest, dest, w, PixelFormat::STRAIGHT, format);
 			}
-			return bitmap;
+			res.analyze();
+			if(mipmapped)
+				res.buildmips();
+			++load_stats.files;
+			load_stats.bytes += file.size;
+			load_stats.microseconds += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+			return res;
 		}
 		void renewhandle() {
 			handle && DeleteObject(handle);
+			// GDI only reads linear pixels, and takes the padding of each
+			// row as extra columns that are never drawn.
+			Bitmap const linear = relayout(Layout::LINEAR);
 			handle = CreateBitmap(
-				dimension[0], dimension[1], 1U, 32U, data.get()
+				pitch, dimension[1], 1U, 32U, linear.data.get()
 			);
 		}
 		HBITMAP gethandle() {
@@ -118,22 +1054,34 @@ namespace Win32GameEngine {
 			hdc = CreateCompatibleDC(NULL);
 			SelectObject(hdc, gethandle());
 		}
+		// Drops the GDI objects; they are recreated from the pixels when
+		// next asked for.
+		void release() {
+			hdc && DeleteDC(hdc);
+			handle && DeleteObject(handle);
+			hdc = NULL;
+			handle = NULL;
+		}
 		HDC getdc() {
 			if(!hdc)
 				renewdc();
 			return hdc;
 		}
 		void put(HDC dest) {
+			put(dest, { 0, 0 }, dimension);
+		}
+		// Blends only the given rectangle, at the same place on `dest`.
+		void put(HDC dest, Vec2I pos, Vec2I size) {
 			AlphaBlend(
 				dest,
-				0, 0, dimension[0], dimension[1],
+				pos[0], pos[1], size[0], size[1],
 				getdc(),
-				0, 0, dimension[0], dimension[1],
+				pos[0], pos[1], size[0], size[1],
 				blend_function
 			);
 		}
 		virtual unsigned locate(Vec2I index) const override {
-			return index.at(1) * dimension.at(0) + index.at(0);
+			return locate((unsigned)index.at(0), (unsigned)index.at(1));
 		}
 		virtual bool valid(Vec2I const index) const override {
 			int x = index.at(0), y = index.at(1);
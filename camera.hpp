@@ -5,9 +5,20 @@
 
 namespace Win32GameEngine {
 	class Camera : public Renderer {
+	public:
+		// Pixel counts of a frame. `shaded` counts every pixel sampled and
+		// blended, `skipped` the pixels a texture covers but front-to-back
+		// drawing found hidden or clear.
+		struct Overdraw {
+			unsigned long long shaded = 0, skipped = 0;
+			// Average number of times each buffer pixel was shaded.
+			inline float factor(unsigned pixels) const {
+				return pixels ? (float)shaded / pixels : 0;
+			}
+		};
 	protected:
 		virtual Vec2F screen_texture(Texture const *texture, Vec2F screenp) const override {
-			SquareMatrix<4, float> camera_entity = ((WorldEntity const *)texture->entity)
+			AffineMatrix<4, float> camera_entity = ((WorldEntity const *)texture->entity)
 				->transform.world.inverse()
 				.compose(entity->getcomponent<WorldTransform>()->world);
 			Vec4F top = screenp;
@@ -22,7 +33,7 @@ namespace Win32GameEngine {
 		virtual Vec2F texture_screen(
 			Texture const *texture, Vec2F texturep 
 		) const override {
-			SquareMatrix<4, float> entity_camera = ((WorldEntity const *)texture->entity)
+			AffineMatrix<4, float> entity_camera = ((WorldEntity const *)texture->entity)
 				->transform.world.inverse()
 				.compose(entity->getcomponent<WorldTransform>()->world);
 			entity_camera = entity_camera.inverse();
@@ -31,12 +42,31 @@ namespace Win32GameEngine {
 			Vec4F camerap = entity_camera(augmented);
 			return camerap * (1 / camerap[2]);
 		}
+		virtual AffineMatrix<3, float> texture_mapping(Texture const *texture) const override {
+			AffineMatrix<4, float> const ce = ((WorldEntity const *)texture->entity)
+				->transform.world.inverse()
+				.compose(entity->getcomponent<WorldTransform>()->world);
+			float const *const m = ce.data, z = -m[11];
+			// Same projection as screen_texture(), folded into a 2D affine map.
+			AffineMatrix<3, float> const screen_texture{
+				{ m[0] * z, m[1] * z, m[2] * z + m[3] },
+				{ m[4] * z, m[5] * z, m[6] * z + m[7] },
+				{ 0, 0, 1 }
+			};
+			AffineMatrix<3, float> const buffer_screen{
+				{ pixel_scale, 0, -buffer_shift[0] * pixel_scale },
+				{ 0, pixel_scale, -buffer_shift[1] * pixel_scale },
+				{ 0, 0, 1 }
+			};
+			return screen_texture.compose(buffer_screen);
+		}
 		Vec2I buffer_shift;
 		float pixel_scale;
+		// Farthest first, by world depth, as the scene's depth list.
 		virtual bool compare(Entity const *a, Entity const *b) override {
 			float
-				az = ((WorldEntity const *)a)->transform.position.value[2],
-				bz = ((WorldEntity const *)b)->transform.position.value[2];
+				az = ((WorldEntity const *)a)->transform.world.data[11],
+				bz = ((WorldEntity const *)b)->transform.world.data[11];
 			return az > bz;
 		}
 		virtual bool validate(Entity const *entity) override {
@@ -49,17 +79,223 @@ namespace Win32GameEngine {
 				return false;
 			return true;
 		}
+		// World-space bound of what a rectangle of buffer pixels can show
+		// between the depths of the scene's spatial index. The view at each
+		// depth is a rectangle scaling with the distance, so the hull of the
+		// nearest and farthest ones holds every depth between. Depths behind
+		// the camera are dropped.
+		Bound viewbound(SpatialIndex const &index, Bound const &pixels) const {
+			AffineMatrix<4, float> const &world = entity->getcomponent<WorldTransform>()->world;
+			// Widened by a pixel, as pixel centers are sampled.
+			Vec2F const
+				a = (pixels.min - buffer_shift - Vec2F{ 1, 1 }) * pixel_scale,
+				b = (pixels.max - buffer_shift + Vec2F{ 1, 1 }) * pixel_scale;
+			float const
+				closest = std::max(index.zmin - world.data[11], 0.f),
+				farthest = std::max(index.zmax - world.data[11], 0.f);
+			Bound res;
+			for(float d : { closest, farthest }) {
+				for(Vec2F const &corner : { a, b, Vec2F{ a[0], b[1] }, Vec2F{ b[0], a[1] } }) {
+					Vec4F const p{ corner[0] * d, corner[1] * d, d, 1 };
+					res.add(world(p));
+				}
+			}
+			return res;
+		}
+		// Only visits the entities near the clips through the spatial index.
+		virtual void collect() override {
+			shared_ptr<SpatialIndex> const &index = entity->scene->index;
+			if(!index || index->empty())
+				return;
+			Bound pixels;
+			for(Bound const &clip : clips) {
+				pixels.add(clip.min);
+				pixels.add(clip.max);
+			}
+			index->query(viewbound(*index, pixels), [&](Entity *e) {
+				if(validate(e))
+					queue.push_back(e);
+			});
+			// The scene keeps its entities sorted by depth across frames.
+			entity->scene->depths->sort(queue);
+		}
+		virtual Bound damaged(Damage const &damage) const override {
+			if(!damage.world)
+				return Bound();
+			AffineMatrix<4, float> const view = entity->getcomponent<WorldTransform>()->world.inverse();
+			float x[4], y[4];
+			damage.bound.corners(x, y);
+			Bound res;
+			for(unsigned i = 0; i < 4; ++i) {
+				Vec4F const p = view(Vec4F{ x[i], y[i], damage.z, 1 });
+				// Behind the camera.
+				if(p[2] <= 0)
+					return Bound();
+				res.add(Vec2F{ p[0] / p[2], p[1] / p[2] } * (1 / pixel_scale) + buffer_shift);
+			}
+			return res;
+		}
 		virtual inline Vec2I screen_buffer(Vec2F screenp) const override {
 			return screenp * (1 / pixel_scale) + buffer_shift;
 		}
 		virtual inline Vec2F buffer_screen(Vec2I bufferp) const override {
-			return (bufferp - buffer_shift) * pixel_scale;
+			return (Vec2F(bufferp) - buffer_shift) * pixel_scale;
+		}
+		static constexpr unsigned tile_size = 64;
+		unsigned threads;
+		unique_ptr<ThreadPool> pool;
+		vector<Draw> draws;
+		// Indices into `draws` touching each tile, in queue order.
+		vector<vector<unsigned>> bins;
+		// Number of opaque pixels in each tile, for front-to-back drawing.
+		vector<unsigned> covered;
+		inline unsigned columns() const { return (buffer->dimension[0] + tile_size - 1) / tile_size; }
+		inline unsigned rows() const { return (buffer->dimension[1] + tile_size - 1) / tile_size; }
+		inline unsigned tilearea(unsigned tile) const {
+			unsigned const x = tile % columns() * tile_size, y = tile / columns() * tile_size;
+			return std::min(tile_size, buffer->dimension[0] - x) * std::min(tile_size, buffer->dimension[1] - y);
+		}
+		// Draws a prepared texture behind what the buffer already holds.
+		// A pixel is done once its alpha is full: such pixels are skipped
+		// before sampling, as are whole tiles once all their pixels are,
+		// and regions of the texture its opacity metadata reports clear.
+		void rasterizeunder(Draw const &draw, Bound clip, Color *scratch, Overdraw &stats) {
+			Texture const *const texture = draw.texture;
+			Vec2F const step = draw.step();
+			BitmapView const target = buffer->view();
+			unsigned const pitch = buffer->pitch, n = columns();
+			spans(draw, clip, [&](int y, int x0, unsigned count, Vec2F origin) {
+				Color *const row = target.row(y);
+				for(int x = x0, end = x0 + (int)count; x < end;) {
+					unsigned const tile = y / tile_size * n + x / tile_size;
+					int const next = std::min(end, (int)((x / tile_size + 1) * tile_size));
+					int const start = x;
+					x = next;
+					if(covered[tile] == tilearea(tile)) {
+						stats.skipped += next - start;
+						continue;
+					}
+					// Trim covered pixels off both ends of the run.
+					int a = start, b = next;
+					while(a < b && row[a].a == 255)
+						++a;
+					while(a < b && row[b - 1].a == 255)
+						--b;
+					stats.skipped += (a - start) + (next - b);
+					if(a == b)
+						continue;
+					Opacity const opacity = texture->getopacity(Bound(
+						origin + step * (float)a, origin + step * (float)(b - 1)
+					), draw.footprint);
+					if(opacity == Opacity::CLEAR) {
+						stats.skipped += b - a;
+						continue;
+					}
+					texture->span(scratch, b - a, origin, step, a, draw.footprint);
+					if(!ids.empty()) {
+						// The first visible sample of a pixel is its topmost.
+						Entity **const id = ids.data() + y * pitch;
+						for(int i = a; i < b; ++i) {
+							if(scratch[i - a].a && !id[i])
+								id[i] = texture->entity;
+						}
+					}
+					covered[tile] += blendunder(row + a, scratch, b - a);
+					stats.shaded += b - a;
+				}
+			});
+		}
+		void sampletiled() {
+			unsigned const
+				w = buffer->dimension[0], h = buffer->dimension[1],
+				columns = this->columns(),
+				rows = this->rows();
+			if(!pool)
+				pool = make_unique<ThreadPool>(threads);
+			draws.clear();
+			for(Entity *const entity : queue)
+				draws.push_back(prepare(entity->getcomponent<Texture>()));
+			if(front_to_back)
+				reverse(draws.begin(), draws.end());
+			bins.resize(columns * rows);
+			for(vector<unsigned> &bin : bins)
+				bin.clear();
+			Bound const whole = extent();
+			for(unsigned i = 0; i < draws.size(); ++i) {
+				Bound const b = draws[i].bound.clip(whole);
+				if(!(b.min[0] <= b.max[0] && b.min[1] <= b.max[1]))
+					continue;
+				unsigned const
+					c0 = (unsigned)ceil(b.min[0]) / tile_size,
+					c1 = (unsigned)floor(b.max[0]) / tile_size,
+					r0 = (unsigned)ceil(b.min[1]) / tile_size,
+					r1 = (unsigned)floor(b.max[1]) / tile_size;
+				for(unsigned r = r0; r <= r1; ++r) {
+					for(unsigned c = c0; c <= c1; ++c)
+						bins[r * columns + c].push_back(i);
+				}
+			}
+			mutex lock;
+			pool->run(columns * rows, [&](unsigned t) {
+				Color scratch[tile_size];
+				Overdraw stats;
+				unsigned const x = t % columns * tile_size, y = t / columns * tile_size;
+				Bound const tile(
+					{ (float)x, (float)y },
+					{ (float)(std::min(x + tile_size, w) - 1), (float)(std::min(y + tile_size, h) - 1) }
+				);
+				for(Bound const &c : clips) {
+					Bound const clip = tile.clip(c);
+					if(clip.empty())
+						continue;
+					for(unsigned i : bins[t]) {
+						if(front_to_back)
+							rasterizeunder(draws[i], clip, scratch, stats);
+						else
+							stats.shaded += rasterize(draws[i], clip, scratch);
+					}
+				}
+				lock_guard<mutex> guard(lock);
+				overdraw.shaded += stats.shaded;
+				overdraw.skipped += stats.skipped;
+			});
 		}
 		virtual void sample() override {
+			overdraw = Overdraw();
+			if(front_to_back && rasterization != Rasterization::PIXELWISE) {
+				// Drawing under requires a transparent start.
+				if(!clear_on_paint) {
+					for(Bound const &clip : clips)
+						clear(clip);
+				}
+				covered.assign(columns() * rows(), 0);
+			}
+			switch(rasterization) {
+			case Rasterization::SCANLINE:
+				if(front_to_back) {
+					// The queue is sorted back to front.
+					for(auto it = queue.rbegin(); it != queue.rend(); ++it) {
+						Draw const draw = prepare((*it)->getcomponent<Texture>());
+						for(Bound const &clip : clips)
+							rasterizeunder(draw, clip, scanline.data(), overdraw);
+					}
+					return;
+				}
+				for(Entity *const entity : queue) {
+					Draw const draw = prepare(entity->getcomponent<Texture>());
+					for(Bound const &clip : clips)
+						overdraw.shaded += rasterize(draw, clip, scanline.data());
+				}
+				return;
+			case Rasterization::TILED:
+				sampletiled();
+				return;
+			}
 			WorldTransform &self_transform = *entity->getcomponent<WorldTransform>();
+			BitmapView const target = buffer->view();
 			for(Entity *const entity : queue) {
 				Texture *const texture = entity->getcomponent<Texture>();
-				SquareMatrix<4, float>camera_entity =
+				AffineMatrix<4, float> camera_entity =
 					((WorldEntity const *)entity)
 					->transform.world.inverse()
 					.compose(self_transform.world);
@@ -74,25 +310,53 @@ namespace Win32GameEngine {
 				for(float y = ymin; y < ymax; y += pixel_scale) {
 					for(float x = xmin; x < xmax; x += pixel_scale) {
 						Vec2F screenp{ x, y }, bufferp = screen_buffer(screenp);
-						Color *pixel = buffer.at(bufferp);
-						if(!pixel)
+						Color *pixel = target.at(bufferp);
+						if(!pixel || !inclips(bufferp))
 							continue;
 						Vec2F texturep = screen_texture(texture, screenp);
 						if(texture->hit(texturep)) {
-							*pixel = *pixel + texture->sample(texturep);
-							int a = 1;
+							++overdraw.shaded;
+							Color const color = texture->sample(texturep);
+							if(!ids.empty() && color.a)
+								ids[pixel - target.data] = entity;
+							*pixel = pixel->composite(color);
 						}
 					}
 				}
 			}
 		}
 	public:
+		enum class Rasterization {
+			// Maps and tests every pixel of the texture's screen bound.
+			PIXELWISE,
+			// Visits only visible pixels, scanline by scanline.
+			SCANLINE,
+			// Scanline rasterization of fixed-size tiles on a thread pool;
+			// the output is identical to SCANLINE.
+			TILED
+		};
+		Rasterization rasterization;
+		// Draws nearest textures first, each under what is already drawn,
+		// so pixels hidden behind opaque ones are never sampled. Only
+		// affects SCANLINE and TILED; the output matches back to front.
+		bool front_to_back;
+		// Pixel counts of the last frame.
+		Overdraw overdraw;
 		Camera(Entity *entity, float view_size) : Renderer(entity),
-			buffer_shift(Vec2F(target().dimension) * .5f) {
+			buffer_shift(Vec2F(target().dimension) * .5f),
+			threads(thread::hardware_concurrency()),
+			rasterization(Rasterization::SCANLINE),
+			front_to_back(false) {
 			setviewsize(view_size);
 		}
+		// Number of threads used by tiled rasterization, the painting thread included.
+		inline void setthreads(unsigned count) {
+			threads = count;
+			pool.reset();
+		}
 		inline float setviewsize(float view_size) {
-			return pixel_scale = view_size / buffer.dimension.module();
+			invalidate();
+			return pixel_scale = view_size / buffer->dimension.module();
 		}
 		inline float setfov(float fov) { setviewsize(tan(fov)); }
 		inline float setfovindegree(int fov) {
@@ -1,9 +1,9 @@
 #pragma once
 
 #include "utils.hpp"
-#include <map>
-#include <set>
+#include <array>
 #include <functional>
+#include <unordered_map>
 
 namespace Win32GameEngine {
 	using namespace std;
@@ -35,20 +35,20 @@ namespace Win32GameEngine {
 		Receiver() {
 			postponeds = vector<Postponed>();
 		}
+		virtual ~Receiver() {}
 		virtual Ret operator()(Event const &event) = 0;
 		void postpone(function<void()> action, time_t time = 0) {
-			Postponed postponed{ action, time };
-			postponeds.push_back(postponed);
+			postponeds.push_back({ move(action), time });
 		}
 		void resolve() {
 			for(auto it = postponeds.begin(); it != postponeds.end(); ) {
-				Postponed postponed = *it;
-				if(postponed.time) {	// TODO: time check
+				if(it->time) {	// TODO: time check
 					++it;
 					continue;
 				}
+				function<void()> const action = move(it->action);
 				it = postponeds.erase(it);
-				postponed.action();
+				action();
 			}
 		}
 	};
@@ -69,17 +69,66 @@ namespace Win32GameEngine {
 		EventMedium(Next next) : next(next) {}
 	};
 
+	// Receivers of each event type, in the order they were added, kept
+	// in a hash table.
+	template<typename Type, typename Receiver>
+	struct HandlerTable {
+		unordered_map<Type, vector<Receiver *>> table;
+		// The receivers of `type`, or null if it has none.
+		inline vector<Receiver *> const *find(Type type) const {
+			auto const it = table.find(type);
+			return it == table.end() ? nullptr : &it->second;
+		}
+		inline void add(Type type, Receiver *receiver) {
+			table[type].push_back(receiver);
+		}
+		template<typename F>
+		void each(F const &f) const {
+			for(auto const &[type, receivers] : table) {
+				for(Receiver *receiver : receivers)
+					f(receiver);
+			}
+		}
+	};
+
+	// An enum whose last member, COUNT, is the number of the others.
+	template<typename Type>
+	concept counted_enum = is_enum_v<Type> && requires { Type::COUNT; };
+
+	// Same, for an enum of event types: an array indexed by the enum, and
+	// a bit per type telling whether it has receivers, so that an event
+	// nothing listens to costs a single test.
+	template<counted_enum Type, typename Receiver>
+	struct HandlerTable<Type, Receiver> {
+		static constexpr unsigned count = (unsigned)Type::COUNT;
+		static_assert(count <= 64);
+		array<vector<Receiver *>, count> table;
+		unsigned long long mask = 0;
+		inline vector<Receiver *> const *find(Type type) const {
+			unsigned const i = (unsigned)type;
+			return mask >> i & 1 ? &table[i] : nullptr;
+		}
+		inline void add(Type type, Receiver *receiver) {
+			unsigned const i = (unsigned)type;
+			table[i].push_back(receiver);
+			mask |= 1ULL << i;
+		}
+		template<typename F>
+		void each(F const &f) const {
+			for(vector<Receiver *> const &receivers : table) {
+				for(Receiver *receiver : receivers)
+					f(receiver);
+			}
+		}
+	};
+
 	template<derived_from_template<Event> Event, typename Ret = void, typename Receiver = Handler<Event, Ret>>
 	struct EventDistributor : public Win32GameEngine::Receiver<Event, Ret> {
 		using EventType = Event::_Type;
-		map<EventType, set<Receiver *>> receivers;
+		HandlerTable<EventType, Receiver> receivers;
 		EventDistributor() : Win32GameEngine::Receiver<Event, Ret>() {}
 		~EventDistributor() {
-			for(pair<EventType, set<Receiver *>> it : receivers) {
-				set<Receiver *> &type = it.second;
-				for(Receiver *receiver : type)
-					delete receiver;
-			}
+			receivers.each([](Receiver *receiver) { delete receiver; });
 		}
 		virtual Ret miss(Event const &) {
 			if constexpr(is_same_v<Ret, void>);
@@ -98,31 +147,32 @@ namespace Win32GameEngine {
 				break;
 			}
 		}
+		// Receivers are indexed rather than iterated, as one may add
+		// another while being called.
 		virtual Ret operator()(Event const &event) override {
-			auto it = receivers.find(event.type);
+			vector<Receiver *> const *const list = receivers.find(event.type);
 			if constexpr(is_same_v<Ret, void>) {
-				if(it == receivers.end())
+				if(!list)
 					miss(event);
 				else {
-					for(auto receiver : it->second)
-						(*receiver)(event);
+					for(size_t i = 0; i < list->size(); ++i)
+						(*(*list)[i])(event);
 				}
 				propagate(event);
 			} else {
 				Ret res;
-				if(it == receivers.end())
+				if(!list)
 					res = miss(event);
 				else {
-					for(auto receiver : it->second)
-						res = (*receiver)(event);
+					for(size_t i = 0; i < list->size(); ++i)
+						res = (*(*list)[i])(event);
 				}
 				propagate(event);
 				return res;
 			}
 		}
 		void add(EventType type, Receiver *receiver) {
-			auto it = receivers.begin();
-			receivers[type].insert(receiver);
+			receivers.add(type, receiver);
 		}
 		template<typename Action>
 		inline void add(EventType type, Action action) {
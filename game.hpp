@@ -3,20 +3,32 @@
 #include <algorithm>
 #include <set>
 #include "utils.hpp"
+#include "spatial.hpp"
+#include "renderlist.hpp"
+#include "asset.hpp"
+#include "archive.hpp"
 
 namespace Win32GameEngine {
 	class Game;
 	class Scene;
 	class Entity;
 	class Component;
+	class SpatialIndex;
+	class Compositor;
 
 	enum class GameEventType {
 		INIT, QUIT,
 		UPDATE, POSTUPDATE,
-		PAINT, POSTPAINT,
+		PREPAINT, PAINT, POSTPAINT,
 		MOUSEDOWN, MOUSEUP, MOUSEMOVE,
 		CLICK,
 		ACTIVATE, INACTIVATE,
+		// An entity's world transform changed.
+		TRANSFORM,
+		// A texture's content changed.
+		TEXTURE,
+		// Number of event types.
+		COUNT
 	};
 	struct GameEvent : Event<GameEventType> {
 	};
@@ -100,6 +112,14 @@ namespace Win32GameEngine {
 		}
 	};
 
+	// A region whose pixels may have changed since the last paint, on the
+	// z plane of world space or in screen space.
+	struct Damage {
+		Bound bound;
+		float z;
+		bool world;
+	};
+
 	class Scene : public GameObject {
 		friend Game;
 	protected:
@@ -111,6 +131,14 @@ namespace Win32GameEngine {
 	public:
 		Game *const game;
 		set<Entity *> entities;
+		// World-space bounds of the scene's textured entities, created with
+		// the first one. May be replaced while empty to change the cell size.
+		shared_ptr<SpatialIndex> index;
+		// Active textured world entities, farthest first, created with the
+		// first one.
+		shared_ptr<RenderList> depths;
+		// Regions changed since the last PREPAINT, with partial redraw on.
+		vector<Damage> damage;
 		virtual void propagateup(GameEvent const &event) override {
 			if(((GameObject *)game)->isactive())
 				((GameObject *)game)->operator()(event);
@@ -135,10 +163,73 @@ namespace Win32GameEngine {
 		Ticker frame;
 		PAINTSTRUCT *ps = new PAINTSTRUCT{};
 		HDC paint_dc;
+		vector<char> region;
+		// Allocations so far counted towards some event type.
+		Allocations attributed;
+		// Reads the window's update region into `paint_rects`. Regions made
+		// of many rectangles are painted as their bounding rectangle.
+		void readupdateregion() {
+			paint_rects.clear();
+			Vec2I const s = window->buffer.dimension;
+			if(!partial_redraw) {
+				paint_rects.push_back(Bound({ 0, 0 }, Vec2F(s) - Vec2F{ 1, 1 }));
+				return;
+			}
+			HRGN rgn = CreateRectRgn(0, 0, 0, 0);
+			GetUpdateRgn(window->handle, rgn, FALSE);
+			DWORD const size = GetRegionData(rgn, 0, NULL);
+			region.resize(std::max<size_t>(size, sizeof(RGNDATA)));
+			RGNDATA *const data = (RGNDATA *)region.data();
+			if(!size || !GetRegionData(rgn, size, data))
+				data->rdh.nCount = 0;
+			DeleteObject(rgn);
+			RECT const *rects = (RECT const *)data->Buffer;
+			unsigned count = data->rdh.nCount;
+			if(count > max_paint_rects) {
+				rects = &data->rdh.rcBound;
+				count = 1;
+			}
+			for(unsigned i = 0; i < count; ++i) {
+				RECT const &r = rects[i];
+				Bound const b(
+					{ (float)std::max(r.left, 0L), (float)std::max(r.top, 0L) },
+					{ (float)std::min(r.right, (LONG)s[0]) - 1, (float)std::min(r.bottom, (LONG)s[1]) - 1 }
+				);
+				if(!b.empty())
+					paint_rects.push_back(b);
+			}
+		}
 	public:
 		Window *const window;
 		bool clear_frame_buffer;
+		// Repaints only what changed each frame instead of the whole window.
+		// Textures record damage as they move, change or toggle; renderers
+		// turn it into window rectangles at PREPAINT, then redraw and
+		// present only the window's update region.
+		bool partial_redraw;
+		static constexpr unsigned max_paint_rects = 16;
+		// Pixel rectangles being painted, set for the duration of PAINT.
+		vector<Bound> paint_rects;
+		// Merges the renderers' output into the window buffer at POSTPAINT;
+		// made by the first renderer.
+		shared_ptr<Compositor> compositor;
 		set<Scene *> scenes;
+		// Scratch memory for the current frame, freed at each update.
+		FrameArena arena;
+		// Loads bitmaps off the game thread; finished ones are published
+		// at the start of each update.
+		AssetLoader assets;
+		// Heap allocations of the last update() and the paints it
+		// dispatched, in total and by the type of the innermost game event
+		// being handled. Counted with WIN32GE_TRACK_ALLOCATIONS defined.
+		// Once every renderer has drawn once, an update and paint of a
+		// scene where nothing changed allocate nothing: per-frame lists
+		// keep their capacity between frames, and transient data goes to
+		// `arena`.
+		struct AllocationStats {
+			Allocations frame;
+			Allocations events[(size_t)GameEventType::COUNT];
+		} allocations;
 		Ticker time;
 		struct Mouse {
 			Vec2F position;
@@ -146,6 +237,7 @@ namespace Win32GameEngine {
 		Game(Window *window) : GameObject(false),
 			paint_dc(NULL), window(window),
 			clear_frame_buffer(true),
+			partial_redraw(false),
 			time(), frame(0),
 			mouse({ { 0, 0 } })
 		{
@@ -202,21 +294,64 @@ namespace Win32GameEngine {
 				}
 			});
 			add(GameEventType::PAINT, [=](GameEvent const &) {
-				if(clear_frame_buffer)
-					HDC bdc = window->buffer.getdc();
+				readupdateregion();
 				paint_dc = BeginPaint(window->handle, ps);
+				if(clear_frame_buffer) {
+					BitmapView const frame = window->buffer.view();
+					for(Bound const &r : paint_rects) {
+						Vec2U const min{ (unsigned)r.min[0], (unsigned)r.min[1] };
+						frame.sub(min, Vec2U{ (unsigned)r.max[0], (unsigned)r.max[1] } - min + Vec2U{ 1, 1 }).fill(Color());
+					}
+				}
 			});
 			add(GameEventType::POSTPAINT, [=](GameEvent const &) {
-				Vec2I s = window->buffer.dimension;
-				BitBlt(paint_dc, 0, 0, s[0], s[1], window->buffer.getdc(), 0, 0, SRCCOPY);
+				compose();
+				present();
 				EndPaint(window->handle, ps);
 			});
 		}
+		// Merges what the renderers drew this paint into the window buffer.
+		// Defined in render.hpp, with the compositor.
+		void compose();
+		// Copies the painted rectangles of the window buffer to the window,
+		// straight from its memory.
+		void present() {
+			Bitmap const &frame = window->buffer;
+			BITMAPINFO info{};
+			info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+			// Rows padded to the pitch pass as extra columns.
+			info.bmiHeader.biWidth = frame.pitch;
+			info.bmiHeader.biPlanes = 1;
+			info.bmiHeader.biBitCount = 32;
+			info.bmiHeader.biCompression = BI_RGB;
+			for(Bound const &r : paint_rects) {
+				Vec2I const pos = r.min, size = r.max - r.min + Vec2F{ 1, 1 };
+				// Each rectangle is handed over as a top-down image of its
+				// own rows, which keeps the source origin unambiguous.
+				info.bmiHeader.biHeight = -size[1];
+				SetDIBitsToDevice(
+					paint_dc,
+					pos[0], pos[1], size[0], size[1],
+					pos[0], 0, 0, size[1],
+					frame.data.get() + pos[1] * frame.pitch, &info, DIB_RGB_COLORS
+				);
+			}
+		}
 		void start() {
 			window->init();
 			operator()({ GameEventType::INIT });
 			activate();
 		}
+		virtual void operator()(GameEvent const &event) override {
+			Allocations const before = Allocations::now(), counted = attributed;
+			GameObject::operator()(event);
+			// Events the game dispatches while handling this one, such as
+			// PAINT during UPDATE, keep their own share.
+			Allocations const all = Allocations::now() - before;
+			allocations.events[(size_t)event.type] += all - (attributed - counted);
+			attributed = counted;
+			attributed += all;
+		}
 		virtual void propagatedown(GameEvent const &event) override {
 			for(Scene *scene : scenes) {
 				if(scene->isactive())
@@ -231,12 +366,32 @@ namespace Win32GameEngine {
 			return addscene(new Scene(this));
 		}
 		void update() {
+			arena.reset();
+			allocations = AllocationStats();
+			Allocations const before = Allocations::now();
+			assets.publish();
 			resolve();
 			operator()({ GameEventType::UPDATE, Propagation::DOWN });
 			operator()({ GameEventType::POSTUPDATE, Propagation::DOWN });
+			allocations.frame = Allocations::now() - before;
 		}
 		void repaint() {
-			InvalidateRect(window->handle, nullptr, false);
+			if(!partial_redraw) {
+				InvalidateRect(window->handle, nullptr, false);
+				return;
+			}
+			operator()({ GameEventType::PREPAINT, Propagation::DOWN });
+			for(Scene *scene : scenes)
+				scene->damage.clear();
+		}
+		// Marks a rectangle of window pixels, inclusive, for the next paint.
+		void invalidate(Bound const &rect) {
+			// Widened by a pixel for rasterization rounding.
+			RECT const r{
+				(LONG)floor(rect.min[0]) - 1, (LONG)floor(rect.min[1]) - 1,
+				(LONG)ceil(rect.max[0]) + 2, (LONG)ceil(rect.max[1]) + 2
+			};
+			InvalidateRect(window->handle, &r, false);
 		}
 		void setupdaterate(ULONGLONG rate) { time.setrate(rate); }
 		void setfps(ULONGLONG fps) { this->frame.setrate(fps ? 1000 / fps : 0); }
@@ -2,24 +2,38 @@
 
 #include <initializer_list>
 #include <utility>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <concepts>
+#include "simd.hpp"
 
 namespace Win32GameEngine {
 	using namespace std;
 
-	template<unsigned D, typename T, typename Impl = void>
+	template<unsigned D, typename T>
+	struct Vector;
+
+	// Element-wise operations shared by vectors and vector accessors.
+	// `Self` is the concrete type providing `operator[]`, `Impl` is the
+	// value type produced by arithmetic. No virtual functions are involved,
+	// so every element access is resolved (and inlined) at compile time.
+	template<unsigned D, typename T, typename Self, typename Impl = Vector<D, T>>
 	struct _Vector {
 		static constexpr unsigned dimension = D;
-		virtual T at(unsigned i) const = 0;
-		virtual T &operator[](unsigned i) = 0;
-		virtual T const &operator[](unsigned i) const = 0;
-		bool operator==(_Vector<D, T> const &v) const {
+		inline Self &self() { return *static_cast<Self *>(this); }
+		inline Self const &self() const { return *static_cast<Self const *>(this); }
+		inline T at(unsigned i) const { return self()[i]; }
+		template<typename V>
+		bool operator==(V const &v) const {
 			for(unsigned i = 0; i < D; ++i) {
 				if(at(i) != v.at(i))
 					return false;
 			}
 			return true;
 		}
-		inline bool operator!=(_Vector<D, T> const &v) const {
+		template<typename V>
+		inline bool operator!=(V const &v) const {
 			return !operator==(v);
 		}
 		template<typename S>
@@ -33,12 +47,15 @@ namespace Win32GameEngine {
 		Impl operator+(V const &v) const {
 			Impl res;
 			for(unsigned i = 0; i < D; ++i)
-				res[i] = at(i) + v.at(i);
+				res[i] = (T)(at(i) + v.at(i));
 			return res;
 		}
 		template<typename V>
 		Impl operator-(V const &v) const {
-			return operator+(v * -1);
+			Impl res;
+			for(unsigned i = 0; i < D; ++i)
+				res[i] = (T)(at(i) - v.at(i));
+			return res;
 		}
 		template<typename V>
 		T dot(V const &v) const {
@@ -63,63 +80,69 @@ namespace Win32GameEngine {
 		}
 	};
 
+	template<typename V>
+	concept vector_like = requires(V const &v) {
+		{ V::dimension } -> convertible_to<unsigned>;
+		v.at(0U);
+	};
+
+	// Plain value vector: trivially copyable and standard-layout,
+	// so a `Vector<D, T>` is exactly `D` packed `T`s.
 	template<unsigned D, typename T>
 	struct Vector : _Vector<D, T, Vector<D, T>> {
 		T data[D];
-		Vector() {
-			for(unsigned i = 0; i < D; ++i)
-				this->operator[](i) = 0;
-		}
-		// Copy constructor
-		Vector(Vector<D, T> const &v) : Vector() {
-			this->operator=(v);
-		}
+		Vector() : data{} {}
 		Vector(initializer_list<T> list) : Vector() {
 			T const *arr = list.begin();
-			for(unsigned i = 0, m = min(list.size(), D); i < m; ++i)
-				this->operator[](i) = arr[i];
+			for(unsigned i = 0, m = min((unsigned)list.size(), D); i < m; ++i)
+				data[i] = arr[i];
 		}
 		Vector(T *array) {
 			for(unsigned i = 0; i < D; ++i)
-				this->operator[](i) = array[i];
+				data[i] = array[i];
 		}
-		template<typename V>
-		Vector(V const &ref) { operator=(ref); }
-		template<typename V>
+		// Converting constructor; missing components are zero-filled.
+		template<vector_like V>
+		Vector(V const &ref) : Vector() { operator=(ref); }
+		template<vector_like V>
 		Vector<D, T> &operator=(V const &v) {
-			for(unsigned i = 0; i < D; ++i)
-				operator[](i) = (T)v.at(i);
+			constexpr unsigned m = min(V::dimension, D);
+			for(unsigned i = 0; i < m; ++i)
+				data[i] = (T)v.at(i);
 			return *this;
 		}
-		virtual inline T at(unsigned i) const override { return data[i]; }
-		virtual inline T &operator[](unsigned i) override { return data[i]; }
-		virtual inline T const &operator[](unsigned i) const override { return data[i]; }
+		inline T &operator[](unsigned i) { return data[i]; }
+		inline T const &operator[](unsigned i) const { return data[i]; }
 	};
 
-	template<unsigned D, typename T, int step, typename Impl = void>
-	struct VectorAccessor : _Vector<D, T, Impl> {
+	// Strided view into storage owned by something else, e.g. a matrix row.
+	template<unsigned D, typename T, int step, typename Impl = Vector<D, T>>
+	struct VectorAccessor : _Vector<D, T, VectorAccessor<D, T, step, Impl>, Impl> {
 		T *const data;
 		VectorAccessor() : data(nullptr) {}
 		VectorAccessor(T *data) : data(data) {}
 		VectorAccessor(VectorAccessor<D, T, step, Impl> const &vector) : VectorAccessor(vector.data) {}
-		template<typename V>
-		VectorAccessor(V const &ref) : VectorAccessor(ref.data) {}
-		template<typename V>
+		// Assignment writes through to the referred storage.
+		VectorAccessor<D, T, step, Impl> &operator=(VectorAccessor<D, T, step, Impl> const &v) {
+			for(unsigned i = 0; i < D; ++i)
+				operator[](i) = v.at(i);
+			return *this;
+		}
+		template<vector_like V>
 		VectorAccessor<D, T, step, Impl> &operator=(V const &v) {
-			constexpr unsigned m = min(v.dimension, D);
+			constexpr unsigned m = min(V::dimension, D);
 			for(unsigned i = 0; i < m; ++i)
 				operator[](i) = (T)v.at(i);
 			return *this;
 		}
-		virtual inline T at(unsigned i) const override { return data[i * step]; }
-		virtual inline T &operator[](unsigned i) override { return data[i * step]; }
-		virtual inline T const &operator[](unsigned i) const override { return data[i * step]; }
+		inline T &operator[](unsigned i) const { return data[i * step]; }
 		Vector<D, T> deref() const {
 			Vector<D, T> res;
 			for(unsigned i = 0; i < D; ++i)
 				res[i] = at(i);
 			return res;
 		}
+		using _Vector<D, T, VectorAccessor<D, T, step, Impl>, Impl>::at;
 	};
 
 	using Vec2I = Vector<2U, int>;
@@ -128,6 +151,7 @@ namespace Win32GameEngine {
 	using Vec3F = Vector<3U, float>;
 	using Vec4F = Vector<4U, float>;
 
+	// Row-major `OD`x`ID` matrix mapping `ID`-vectors to `OD`-vectors.
 	template<unsigned OD, unsigned ID, typename T>
 	struct Matrix {
 		using In = Vector<ID, T>;
@@ -138,42 +162,111 @@ namespace Win32GameEngine {
 		using Diag = VectorAccessor<diagonal_size, T, ID + 1, Vector<diagonal_size, T>>;
 		static constexpr unsigned size = ID * OD;
 		T data[size];
-		Matrix() {
-			for(unsigned i = 0; i < size; ++i)
-				data[i] = 0;
-		}
-		Matrix(Matrix<OD, ID, T> const &matrix) {
-			for(unsigned i = 0; i < size; ++i)
-				data[i] = matrix.data[i];
-		}
+		Matrix() : data{} {}
 		Matrix(initializer_list<T> list) : Matrix() {
 			T const *arr = list.begin();
-			for(unsigned i = 0, m = min(list.size(), size); i < m; ++i)
+			for(unsigned i = 0, m = min((unsigned)list.size(), size); i < m; ++i)
 				data[i] = arr[i];
 		}
 		Matrix(initializer_list<initializer_list<T>> list) : Matrix() {
 			initializer_list<T> const *rows = list.begin();
-			for(unsigned i = 0, m = min(list.size(), OD); i < m; ++i) {
+			for(unsigned i = 0, m = min((unsigned)list.size(), OD); i < m; ++i) {
 				T const *arr = rows[i].begin();
 				Row _row = row(i);
-				for(unsigned j = 0; j < min(rows[i].size(), ID); ++j)
+				for(unsigned j = 0, n = min((unsigned)rows[i].size(), ID); j < n; ++j)
 					_row[j] = arr[j];
 			}
 		}
 		inline Row row(unsigned i) const { return Row((T *)data + i * ID); }
 		inline Col col(unsigned i) const { return Col((T *)data + i); }
 		inline Diag diag() const { return Diag((T *)data); }
-		virtual Out operator()(In vector) const {
+		Out operator()(In const &vector) const {
 			Out res;
-			for(unsigned i = 0; i < OD; ++i)
-				res[i] = row(i).dot(vector);
+			if constexpr(is_same_v<T, float> && OD == 4 && ID == 4)
+				SIMD::transform4(data, vector.data, res.data);
+			else if constexpr(is_same_v<T, float> && OD == 3 && ID == 3)
+				SIMD::transform3(data, vector.data, res.data);
+			else {
+				for(unsigned i = 0; i < OD; ++i) {
+					T const *r = data + i * ID;
+					T sum = 0;
+					for(unsigned j = 0; j < ID; ++j)
+						sum += r[j] * vector.data[j];
+					res.data[i] = sum;
+				}
+			}
 			return res;
 		}
+		// Applies the matrix to `count` vectors stored as separate coordinate
+		// arrays: `in[j][k]` is the j-th component of the k-th vector. A null
+		// input array stands for all-zero components. When `homogeneous` is
+		// set, the last input component is an implicit 1 and `in[ID - 1]` is
+		// ignored. Float matrices process a SIMD register of vectors at once.
+		void transform(
+			T const *const *in, T *const *out, size_t count,
+			bool homogeneous = false
+		) const {
+			size_t k = 0;
+			if constexpr(is_same_v<T, float>) {
+				using Float = SIMD::Float;
+				constexpr unsigned W = Float::width;
+				Float m[size];
+				for(unsigned i = 0; i < size; ++i)
+					m[i] = Float::set1(data[i]);
+				for(; k + W <= count; k += W) {
+					Float x[ID];
+					for(unsigned j = 0; j < ID; ++j) {
+						if(homogeneous && j == ID - 1)
+							x[j] = Float::set1(1);
+						else
+							x[j] = in[j] ? Float::load(in[j] + k) : Float::set1(0);
+					}
+					for(unsigned i = 0; i < OD; ++i) {
+						Float sum = m[i * ID] * x[0];
+						for(unsigned j = 1; j < ID; ++j)
+							sum = sum + m[i * ID + j] * x[j];
+						sum.store(out[i] + k);
+					}
+				}
+			}
+			for(; k < count; ++k) {
+				T x[ID];
+				for(unsigned j = 0; j < ID; ++j) {
+					if(homogeneous && j == ID - 1)
+						x[j] = 1;
+					else
+						x[j] = in[j] ? in[j][k] : 0;
+				}
+				for(unsigned i = 0; i < OD; ++i) {
+					T const *r = data + i * ID;
+					T sum = 0;
+					for(unsigned j = 0; j < ID; ++j)
+						sum += r[j] * x[j];
+					out[i][k] = sum;
+				}
+			}
+		}
 		template<typename M>
-		Matrix<M::Out::dimension, ID, T> compose(M const &matrix) const {
-			Matrix<M::Out::dimension, ID, T> res;
-			for(unsigned c = 0; c < ID; ++c)
-				res.col(c) = operator()(matrix.col(c));
+		Matrix<OD, M::In::dimension, T> compose(M const &matrix) const {
+			constexpr unsigned N = M::In::dimension;
+			static_assert(M::Out::dimension == ID, "Incompatible matrix dimensions.");
+			Matrix<OD, N, T> res;
+			if constexpr(is_same_v<T, float> && OD == 4 && ID == 4 && N == 4) {
+				SIMD::compose4(data, matrix.data, res.data);
+				return res;
+			} else if constexpr(is_same_v<T, float> && OD == 3 && ID == 3 && N == 3) {
+				SIMD::compose3(data, matrix.data, res.data);
+				return res;
+			}
+			for(unsigned r = 0; r < OD; ++r) {
+				T const *a = data + r * ID;
+				T *out = res.data + r * N;
+				for(unsigned k = 0; k < ID; ++k) {
+					T const s = a[k], *b = matrix.data + k * N;
+					for(unsigned c = 0; c < N; ++c)
+						out[c] += s * b[c];
+				}
+			}
 			return res;
 		}
 	};
@@ -185,6 +278,31 @@ namespace Win32GameEngine {
 		SquareMatrix(Matrix<D, D, T> const &matrix) : Base(matrix) {}
 		SquareMatrix(initializer_list<T> list) : Base(list) {}
 		SquareMatrix(initializer_list<initializer_list<T>> list) : Base(list) {}
+		// Transforms `count` points of dimension D - 1 stored as separate
+		// coordinate arrays, dividing each result by its homogeneous weight.
+		// A null input array stands for all-zero coordinates.
+		void transformpoints(T const *const *in, T *const *out, size_t count) const {
+			constexpr size_t chunk = 256;
+			T w[chunk];
+			T *res[D];
+			for(unsigned i = 0; i < D - 1; ++i)
+				res[i] = out[i];
+			res[D - 1] = w;
+			for(size_t k = 0; k < count; k += chunk) {
+				size_t const n = min(chunk, count - k);
+				T const *src[D];
+				for(unsigned i = 0; i < D - 1; ++i)
+					src[i] = in[i] ? in[i] + k : nullptr;
+				src[D - 1] = nullptr;
+				this->transform(src, res, n, true);
+				for(unsigned i = 0; i < D - 1; ++i) {
+					T *o = res[i];
+					for(size_t j = 0; j < n; ++j)
+						o[j] /= w[j];
+					res[i] += n;
+				}
+			}
+		}
 		SquareMatrix<D, T> inverse() const {
 			using Augmented = Matrix<D, 2U * D, T>;
 			// Invert a square matrix by Gaussian elimination.
@@ -235,4 +353,97 @@ namespace Win32GameEngine {
 			return res;
 		}
 	};
-}
\ No newline at end of file
+
+	// Square matrix whose last row is known to be (0, ..., 0, 1), i.e. a
+	// linear part plus a translation. Composing affine matrices stays affine,
+	// and inversion uses the closed form instead of Gaussian elimination.
+	template<unsigned D, typename T>
+	struct AffineMatrix : SquareMatrix<D, T> {
+		using Base = SquareMatrix<D, T>;
+		using Point = Vector<D - 1, T>;
+		// Identity by default.
+		AffineMatrix() : Base() {
+			for(unsigned i = 0; i < D; ++i)
+				this->data[i * (D + 1)] = 1;
+		}
+		explicit AffineMatrix(Matrix<D, D, T> const &matrix) : Base(matrix) {}
+		AffineMatrix(initializer_list<initializer_list<T>> list) : Base(list) {}
+		using Base::compose;
+		inline AffineMatrix<D, T> compose(AffineMatrix<D, T> const &matrix) const {
+			return AffineMatrix<D, T>(Base::compose(matrix));
+		}
+		// Transforms a point, i.e. a vector with implicit homogeneous 1.
+		Point point(Point const &p) const {
+			Point res;
+			if constexpr(is_same_v<T, float> && D == 4) {
+				float v[4] = { p.data[0], p.data[1], p.data[2], 1 }, out[4];
+				SIMD::transform4(this->data, v, out);
+				for(unsigned i = 0; i < 3; ++i)
+					res.data[i] = out[i];
+			} else {
+				for(unsigned i = 0; i < D - 1; ++i) {
+					T const *r = this->data + i * D;
+					T sum = r[D - 1];
+					for(unsigned j = 0; j < D - 1; ++j)
+						sum += r[j] * p.data[j];
+					res.data[i] = sum;
+				}
+			}
+			return res;
+		}
+		// Batched `point()`: no homogeneous division is needed, and only
+		// the first D - 1 rows are evaluated.
+		void transformpoints(T const *const *in, T *const *out, size_t count) const {
+			Matrix<D - 1, D, T> top;
+			for(unsigned i = 0; i < top.size; ++i)
+				top.data[i] = this->data[i];
+			T const *src[D];
+			for(unsigned i = 0; i < D - 1; ++i)
+				src[i] = in[i];
+			src[D - 1] = nullptr;
+			top.transform(src, out, count, true);
+		}
+		AffineMatrix<D, T> inverse() const {
+			T const *m = this->data;
+			AffineMatrix<D, T> res;
+			T *r = res.data;
+			if constexpr(D == 3) {
+				// [a b; c d]^-1 = [d -b; -c a] / det
+				T const det = m[0] * m[4] - m[1] * m[3], s = 1 / det;
+				r[0] = m[4] * s;
+				r[1] = -m[1] * s;
+				r[3] = -m[3] * s;
+				r[4] = m[0] * s;
+			} else if constexpr(D == 4) {
+				// Adjugate of the upper-left 3x3 block over its determinant.
+				T const
+					c00 = m[5] * m[10] - m[6] * m[9],
+					c01 = m[6] * m[8] - m[4] * m[10],
+					c02 = m[4] * m[9] - m[5] * m[8];
+				T const det = m[0] * c00 + m[1] * c01 + m[2] * c02, s = 1 / det;
+				r[0] = c00 * s;
+				r[1] = (m[2] * m[9] - m[1] * m[10]) * s;
+				r[2] = (m[1] * m[6] - m[2] * m[5]) * s;
+				r[4] = c01 * s;
+				r[5] = (m[0] * m[10] - m[2] * m[8]) * s;
+				r[6] = (m[2] * m[4] - m[0] * m[6]) * s;
+				r[8] = c02 * s;
+				r[9] = (m[1] * m[8] - m[0] * m[9]) * s;
+				r[10] = (m[0] * m[5] - m[1] * m[4]) * s;
+			} else
+				return AffineMatrix<D, T>(Base::inverse());
+			// Translation: -A^-1 * t.
+			for(unsigned i = 0; i < D - 1; ++i) {
+				T sum = 0;
+				for(unsigned j = 0; j < D - 1; ++j)
+					sum += r[i * D + j] * m[j * D + D - 1];
+				r[i * D + D - 1] = -sum;
+			}
+			return res;
+		}
+	};
+
+	static_assert(is_trivially_copyable_v<Vec4F> && is_standard_layout_v<Vec4F>);
+	static_assert(sizeof(Vec4F) == 4 * sizeof(float) && sizeof(Vec2F) == 2 * sizeof(float));
+	static_assert(is_trivially_copyable_v<SquareMatrix<4, float>>);
+}
@@ -3,68 +3,104 @@
 
 #include "game.hpp"
 #include "transform.hpp"
+#include "spatial.hpp"
+#include "atlas.hpp"
 
 namespace Win32GameEngine {
-	struct Bound {
-		using V = Vec2F;
-		V min, max;
-		Bound() : min{ INFINITY, INFINITY }, max{ -INFINITY, -INFINITY } {}
-		Bound(V min, V max) : Bound() {
-			add(min);
-			add(max);
-		}
-		Bound(Bound const &r) : Bound(V(r.min), V(r.max)) {}
-		V topleft() const { return min; }
-		V topright() const { return { max[0], min[1] }; }
-		V bottomright() const { return max; }
-		V bottomleft() const { return { min[0], max[1] }; }
-		void add(V point) {
-			min[0] = std::min(point[0], min[0]);
-			min[1] = std::min(point[1], min[1]);
-			max[0] = std::max(point[0], max[0]);
-			max[1] = std::max(point[1], max[1]);
-		}
-		Bound transform(function<V(V)> f) const {
-			Bound res;
-			res.add(f(topleft()));
-			res.add(f(topright()));
-			res.add(f(bottomleft()));
-			res.add(f(bottomright()));
-			return res;
-		}
-		Bound transform(SquareMatrix<3, float> m) const {
-			return transform([&](Vec2F v) { return m(v); });
-		}
-		Bound clip(Bound r) const {
-			Bound res;
-			res.min[0] = std::max(r.min[0], min[0]);
-			res.min[1] = std::max(r.min[1], min[1]);
-			res.max[0] = std::min(r.max[0], max[0]);
-			res.max[1] = std::min(r.max[1], max[1]);
-			return res;
+	class Texture : public Component {
+	protected:
+		WorldTransform const *const world_transform;
+		ScreenTransform const *const screen_transform;
+		// Bound in the space of the entity's transform, at depth `depth`.
+		Bound placement;
+		float depth;
+		// Recomputes the placement, keeping the scene's spatial index in
+		// sync with it.
+		void place() {
+			if(world_transform) {
+				placement = bound.transform(world_transform->world);
+				depth = world_transform->world.data[11];
+				shared_ptr<SpatialIndex> &index = entity->scene->index;
+				if(!index)
+					index = make_shared<SpatialIndex>();
+				index->update(entity, placement, depth);
+				shared_ptr<RenderList> &depths = entity->scene->depths;
+				if(!depths)
+					depths = make_shared<RenderList>();
+				if(entity->isactive() && isactive())
+					depths->update(entity, -depth);
+				else
+					depths->remove(entity);
+			}
+			else if(screen_transform) {
+				placement = bound.transform(screen_transform->world);
+				depth = 0;
+			}
 		}
-		inline bool in(Vec2F p) const {
-			return (
-				p[0] >= min[0] && p[1] >= min[1] &&
-				p[0] <= max[0] && p[1] <= max[1]
-			);
+		// Re-places the texture, recording both its old and new placements
+		// as damage when the game redraws partially.
+		void damage() {
+			++version;
+			Scene *const scene = entity->scene;
+			if(!scene->game->partial_redraw) {
+				place();
+				return;
+			}
+			bool const world = world_transform != nullptr;
+			if(!placement.empty())
+				scene->damage.push_back({ placement, depth, world });
+			place();
+			if(!placement.empty())
+				scene->damage.push_back({ placement, depth, world });
 		}
-	};
-
-	class Texture : public Component {
 	public:
 		Vec2F size, anchor;
 		Bound bound;
+		// Bumped whenever the texture's look or placement may have changed.
+		unsigned long long version;
 		Texture(Entity *entity, Vec2F size, Vec2F anchor) :
-			Component(entity), size(size), anchor(anchor),
-			bound(Bound(anchor * -1, size - anchor)) {
+			Component(entity), size(size), anchor(anchor), version(0),
+			bound(Bound(anchor * -1, size - anchor)),
+			world_transform(entity->getcomponent<WorldTransform>()),
+			screen_transform(entity->getcomponent<ScreenTransform>()),
+			depth(0) {
+			for(GameEventType type : { GameEventType::TRANSFORM, GameEventType::TEXTURE, GameEventType::ACTIVATE, GameEventType::INACTIVATE })
+				add(type, [=](GameEvent const &) { damage(); });
+			// The entity being toggled shows or hides the texture too.
+			for(GameEventType type : { GameEventType::ACTIVATE, GameEventType::INACTIVATE })
+				entity->add(type, [=](GameEvent const &) { damage(); });
+			damage();
+		}
+		~Texture() {
+			if(world_transform) {
+				entity->scene->index->remove(entity);
+				entity->scene->depths->remove(entity);
+			}
 		}
 		void setanchor(Vec2F a) {
 			anchor = a;
 			bound = Bound(a * -1, size - a);
+			damage();
 		}
 		inline bool hit(Vec2F uv) const { return bound.in(uv); }
+		// Samples are premultiplied.
 		virtual Color sample(Vec2F uv) const = 0;
+		// Samples pixels `first` to `first + count - 1` of a scanline into
+		// `dest`, where pixel x maps to `origin + step * x`. Each point is
+		// evaluated from its own position, so a pixel's texel never depends
+		// on where its span happens to start. `footprint` is the texture
+		// length a pixel covers, for textures that filter.
+		virtual void span(Color *dest, unsigned count, Vec2F origin, Vec2F step, int first, float footprint) const {
+			for(unsigned i = 0; i < count; ++i) {
+				Vec2F const uv = origin + step * (float)(first + (int)i);
+				dest[i] = hit(uv) ? sample(uv) : Color();
+			}
+		}
+		// Opacity of what span() samples over `region`, in texture space.
+		// May be conservative: MIXED is always a valid answer.
+		virtual Opacity getopacity(Bound region, float footprint) const {
+			return Opacity::MIXED;
+		}
 		virtual void put(Bitmap &bitmap, Bound bound) = 0;
 	};
 
@@ -73,13 +109,23 @@ namespace Win32GameEngine {
 		Color color;
 	public:
 		ColorBox(Entity *entity, Color color, Vec2F size, Vec2F anchor) :
-			Texture(entity, size, anchor), color(color), pixel({ 1, 1 }) {
-			*pixel.data.get() = color;
-			pixel.renewhandle();
-			pixel.renewdc();
+			Texture(entity, size, anchor), color(color.premultiply()), pixel({ 1, 1 }) {
+			*pixel.data.get() = this->color;
 		}
 		ColorBox(Entity *entity, Color color, Vec2F size) : ColorBox(entity, color, size, size * .5f) {}
+		void setcolor(Color c) {
+			color = c.premultiply();
+			*pixel.data.get() = color;
+			pixel.release();
+			operator()({ GameEventType::TEXTURE });
+		}
 		inline virtual Color sample(Vec2F uv) const override { return color; }
+		virtual void span(Color *dest, unsigned count, Vec2F origin, Vec2F step, int first, float footprint) const override {
+			fill(dest, dest + count, color);
+		}
+		virtual Opacity getopacity(Bound region, float footprint) const override {
+			return opacityof(color);
+		}
 		virtual void put(Bitmap &dest, Bound bound) override {
 			Vec2I pos = bound.topleft(), size = bound.bottomright() - pos;
 			AlphaBlend(
@@ -94,61 +140,198 @@ namespace Win32GameEngine {
 
 	class Sprite : public Texture {
 	public:
+		// Always premultiplied; other formats are converted on construction.
 		Bitmap bitmap;
+		// Top left texel of the drawn part of `bitmap`, which is `size`
+		// texels large; nonzero for sprites drawing a region of an atlas.
+		Vec2U offset;
 		Sprite(Entity *entity, Bitmap const &bitmap, Vec2F anchor) :
-			Texture(entity, bitmap.dimension, anchor), bitmap(bitmap) {
+			Texture(entity, bitmap.dimension, anchor), bitmap(bitmap.as(PixelFormat::PREMULTIPLIED)), offset{ 0, 0 } {
+			if(!this->bitmap.blocks)
+				this->bitmap.analyze();
 		}
 		Sprite(Entity *entity, Bitmap const &bitmap) : Sprite(entity, bitmap, bitmap.dimension * .5f) {}
+		Sprite(Entity *entity, AtlasRegion const &region, Vec2F anchor) :
+			Texture(entity, region.size, anchor), bitmap(region.page), offset(region.offset) {
+			if(!bitmap.blocks)
+				bitmap.analyze();
+		}
+		Sprite(Entity *entity, AtlasRegion const &region) : Sprite(entity, region, region.size * .5f) {}
+		// Swaps the bitmap, keeping the anchor at the same fraction of the size.
+		void setbitmap(Bitmap const &b) {
+			setregion({ b, { 0, 0 }, b.dimension });
+		}
+		void setregion(AtlasRegion const &region) {
+			Vec2F const fraction{ anchor[0] / size[0], anchor[1] / size[1] };
+			// Bitmap has const members, so it is rebuilt in place, from a
+			// replacement made first: only the copy, which shares pixels and
+			// cannot throw, runs between destruction and construction.
+			Bitmap next = region.page.as(PixelFormat::PREMULTIPLIED);
+			bitmap.~Bitmap();
+			new(&bitmap) Bitmap(next);
+			if(!bitmap.blocks)
+				bitmap.analyze();
+			offset = region.offset;
+			size = region.size;
+			anchor = Vec2F{ size[0] * fraction[0], size[1] * fraction[1] };
+			bound = Bound(anchor * -1, size - anchor);
+			operator()({ GameEventType::TEXTURE });
+		}
 		inline virtual Color sample(Vec2F uv) const override {
-			Color *color = bitmap.at(uv + anchor);
-			if(!color)
+			Vec2F const p = uv + anchor;
+			if(!(p[0] >= 0 && p[1] >= 0 && p[0] < size[0] && p[1] < size[1]))
 				return Color();
-			return *color;
+			// The region lies within the bitmap, so no bounds check is left.
+			Vec2I const q = p + offset;
+			return bitmap.data.get()[bitmap.locate((unsigned)q[0], (unsigned)q[1])];
+		}
+		// Mip level whose texels best match a pixel covering `footprint`
+		// texels; 0 when the bitmap has no mips.
+		inline unsigned mipfor(float footprint) const {
+			if(!bitmap.mips || footprint < 2)
+				return 0;
+			return std::min((unsigned)log2(footprint), bitmap.levels() - 1);
+		}
+		// span() for one storage layout of the bitmap.
+		template<Layout L>
+		void spanin(Color *dest, unsigned count, Vec2F origin, Vec2F step, int first, float footprint) const {
+			unsigned const level = mipfor(footprint);
+			Bitmap const &mip = bitmap.mip(level);
+			Color const *const texels = mip.data.get();
+			unsigned const pitch = mip.pitch;
+			unsigned const rw = (unsigned)size[0], rh = (unsigned)size[1], ox = offset[0], oy = offset[1];
+			float const u = origin[0] + anchor[0], v = origin[1] + anchor[1];
+			if(!level) {
+				for(unsigned i = 0; i < count; ++i) {
+					float const t = (float)(first + (int)i);
+					unsigned const x = (unsigned)(int)(u + step[0] * t), y = (unsigned)(int)(v + step[1] * t);
+					dest[i] = x < rw && y < rh ? texels[Bitmap::locate<L>(x + ox, y + oy, pitch)] : Color();
+				}
+				return;
+			}
+			// Bounds are checked against the region in full texels; level
+			// texels are 2^level of those wide.
+			float const s = 1.f / (1U << level);
+			float const mu = (u + ox) * s, mv = (v + oy) * s, su = step[0] * s, sv = step[1] * s;
+			for(unsigned i = 0; i < count; ++i) {
+				float const t = (float)(first + (int)i);
+				unsigned const x = (unsigned)(int)(u + step[0] * t), y = (unsigned)(int)(v + step[1] * t);
+				dest[i] = x < rw && y < rh
+					? texels[Bitmap::locate<L>((unsigned)(mu + su * t), (unsigned)(mv + sv * t), pitch)]
+					: Color();
+			}
+		}
+		virtual void span(Color *dest, unsigned count, Vec2F origin, Vec2F step, int first, float footprint) const override {
+			if(bitmap.layout == Layout::TILED)
+				spanin<Layout::TILED>(dest, count, origin, step, first, footprint);
+			else
+				spanin<Layout::LINEAR>(dest, count, origin, step, first, footprint);
+		}
+		virtual Opacity getopacity(Bound region, float footprint) const override {
+			// Widened to whole texels of the sampled level.
+			int const size = 1 << mipfor(footprint);
+			Vec2F const min = region.min + anchor + offset, max = region.max + anchor + offset;
+			auto down = [=](float f) { return (int)floor(f / size) * size; };
+			Vec2I const lo{ down(min[0]), down(min[1]) };
+			Vec2I const hi{ down(max[0]) + size - 1, down(max[1]) + size - 1 };
+			Opacity const res = bitmap.getopacity(lo, hi);
+			// Texels past the drawn region sample as clear.
+			Vec2I const o = offset, end = o + Vec2I{ (int)this->size[0], (int)this->size[1] };
+			bool const outside = lo[0] < o[0] || lo[1] < o[1] || hi[0] >= end[0] || hi[1] >= end[1];
+			return outside ? res | Opacity::CLEAR : res;
 		}
 		virtual void put(Bitmap &dest, Bound bound) override {
-			Vec2I pos = bound.topleft(), size = bound.bottomright() - pos;
+			Vec2I pos = bound.topleft(), extent = bound.bottomright() - pos;
 			AlphaBlend(
 				dest.getdc(),
-				pos[0], pos[1], size[0], size[1],
+				pos[0], pos[1], extent[0], extent[1],
 				bitmap.getdc(),
-				0, 0, bitmap.dimension[0], bitmap.dimension[1],
+				offset[0], offset[1], (int)this->size[0], (int)this->size[1],
 				blend_function
 			);
 		}
 	};
 
+	class Renderer;
+
+	// Builds each paint's frame from the renderers that received PAINT,
+	// bottom to top by `order`. The bottom renderer draws straight into
+	// the window buffer; the others draw into their own buffers, which
+	// are then blended over it together, row by row, skipping the ones
+	// known to be blank.
+	class Compositor {
+		vector<Renderer *> pending;
+		vector<Bitmap const *> layers;
+		vector<Bound> rects;
+	public:
+		// Queues a renderer after those of lower or equal order, which
+		// keeps `pending` sorted without a sort's scratch memory.
+		void submit(Renderer *renderer);
+		void compose(Game *game);
+	};
+
+
 	class Renderer : public Component {
+		friend Compositor;
 	protected:
-		Bitmap &buffer;
+		// Where the renderer draws: its own bitmap, or the window buffer
+		// itself when it is the bottom layer of the frame.
+		Bitmap *buffer;
+		unique_ptr<Bitmap> canvas;
 		inline Bitmap &target() {
 			return entity->scene->game->window->buffer;
 		}
 		vector<Entity *> queue;
+		vector<Color> scanline;
+		// Topmost entity drawn at each buffer pixel, kept while
+		// `pick_buffer` is set.
+		vector<Entity *> ids;
+		// Parts of the buffer to redraw this paint, in buffer pixels.
+		vector<Bound> clips;
+		// Whether the whole buffer needs redrawing at the next PREPAINT.
+		bool stale;
+		// Whether the next draw must sample even if the queue looks the
+		// same as last time.
+		bool changed;
+		// digest() of the queue last drawn.
+		unsigned long long drawn;
+		// Whether the buffer is known to be fully transparent.
+		bool blank;
 		Renderer(Entity *entity) : Component(entity),
 			queue(),
+			scanline(target().dimension[0]),
+			stale(true),
+			changed(true),
+			drawn(0),
+			blank(false),
 			clear_on_paint(true),
-			buffer(*new Bitmap(target().dimension)),
+			pick_buffer(false),
+			mipmapping(true),
+			buffer(&target()),
 			order(0)
 		{
+			shared_ptr<Compositor> &compositor = entity->scene->game->compositor;
+			if(!compositor)
+				compositor = make_shared<Compositor>();
+			add(GameEventType::PREPAINT, [=](GameEvent) {
+				Game *const game = entity->scene->game;
+				Bound const whole = extent();
+				if(stale) {
+					game->invalidate(whole);
+					stale = false;
+					return;
+				}
+				for(Damage const &damage : entity->scene->damage) {
+					Bound const b = damaged(damage).clip(whole);
+					if(!b.empty())
+						game->invalidate(b);
+				}
+			});
+			// Moving the renderer's own entity changes the whole view.
+			add(GameEventType::TRANSFORM, [=](GameEvent) { invalidate(); });
+			// Drawn later by the compositor, in `order`.
 			add(GameEventType::PAINT, [=](GameEvent) {
-				Scene *scene = entity->scene;
-				queue.clear();
-				copy_if(
-					scene->entities.begin(),
-					scene->entities.end(),
-					back_inserter(queue),
-					[&](Entity const *e) { return validate(e); }
-				);
-				sort(
-					queue.begin(), queue.end(),
-					[&](Entity const *a, Entity const *b) { return compare(a, b); }
-				);
-				if(clear_on_paint)
-					clear();
-				sample();
-				buffer.renewhandle();
-				buffer.renewdc();
-				buffer.put(target().getdc());
+				entity->scene->game->compositor->submit(this);
 			});
 			add(GameEventType::MOUSEDOWN, [=](GameEvent) {
 				Entity *hit = cast(entity->scene->game->mouse.position);
@@ -157,8 +340,68 @@ namespace Win32GameEngine {
 				hit->operator()({ GameEventType::CLICK, Propagation::UP });
 			});
 		}
-		~Renderer() {
-			delete &buffer;
+		// Merges overlapping rectangles into their bounding rectangle, so
+		// no pixel is drawn or blended twice.
+		static void merge(vector<Bound> &rects) {
+			for(size_t i = 0; i < rects.size(); ++i) {
+				for(size_t j = i + 1; j < rects.size(); ++j) {
+					if(!rects[i].intersects(rects[j]))
+						continue;
+					rects[i].add(rects[j].min);
+					rects[i].add(rects[j].max);
+					rects.erase(rects.begin() + j);
+					j = i;
+				}
+			}
+		}
+		// Draws this paint's rectangles into `into`. Drawing again into the
+		// same bitmap is skipped when the queue's digest is unchanged,
+		// except into the window buffer, which is cleared every paint.
+		void draw(Bitmap *into) {
+			bool const moved = buffer != into;
+			buffer = into;
+			clips.clear();
+			for(Bound const &rect : entity->scene->game->paint_rects) {
+				Bound const b = rect.clip(extent());
+				if(!b.empty())
+					clips.push_back(b);
+			}
+			// A canvas just taken over holds nothing of this view, so all
+			// of it is drawn, not only what the window repaints now.
+			if(moved && into != &target())
+				clips.assign(1, extent());
+			if(clips.empty())
+				return;
+			merge(clips);
+			queue.clear();
+			collect();
+			unsigned long long const d = digest();
+			if(!moved && !changed && d == drawn && into != &target())
+				return;
+			drawn = d;
+			changed = false;
+			if(!pick_buffer)
+				vector<Entity *>().swap(ids);
+			else if(ids.size() != buffer->size)
+				ids.assign(buffer->size, nullptr);
+			if(clear_on_paint) {
+				for(Bound const &clip : clips)
+					clear(clip);
+			}
+			sample();
+			Bound const whole = extent();
+			bool const all = clips.size() == 1 && clips[0].min == whole.min && clips[0].max == whole.max;
+			blank = queue.empty() && clear_on_paint && (all || (blank && !moved));
+		}
+		// Mixes the queued entities and their texture versions, so that a
+		// change to any of them changes the digest.
+		virtual unsigned long long digest() const {
+			unsigned long long res = queue.size();
+			for(Entity const *const e : queue) {
+				Texture const *const texture = e->getcomponent<Texture>();
+				res = (res ^ (unsigned long long)(uintptr_t)e) * 0x100000001B3ULL + (texture ? texture->version : 0);
+			}
+			return res;
 		}
 		virtual Vec2F screen_texture(Texture const *texture, Vec2F screenp) const = 0;
 		virtual Vec2F texture_screen(Texture const *texture, Vec2F texturep) const = 0;
@@ -170,15 +413,161 @@ namespace Win32GameEngine {
 		inline Vec2I texture_buffer(Texture const *texture, Vec2F texturep) const {
 			return screen_buffer(texture_screen(texture, texturep));
 		}
+		// Affine map from buffer pixels to the texture's space.
+		virtual AffineMatrix<3, float> texture_mapping(Texture const *texture) const = 0;
+		// Pixel bound of the whole buffer.
+		inline Bound extent() const {
+			return Bound({ 0, 0 }, Vec2F(buffer->dimension) - Vec2F{ 1, 1 });
+		}
+		// A texture prepared for rasterization: its affine map from buffer
+		// pixels to texture space and its bound in buffer space.
+		struct Draw {
+			Texture const *texture;
+			AffineMatrix<3, float> mapping;
+			Bound bound;
+			// Texture length a pixel covers along its longer side.
+			float footprint;
+			// Texture-space step between horizontally adjacent pixels.
+			inline Vec2F step() const { return { mapping.data[0], mapping.data[3] }; }
+		};
+		Draw prepare(Texture const *texture) const {
+			AffineMatrix<3, float> mapping = texture_mapping(texture);
+			Bound bound = texture->bound.transform(mapping.inverse());
+			float const *const m = mapping.data;
+			float const footprint = mipmapping ? std::max(hypot(m[0], m[3]), hypot(m[1], m[4])) : 1;
+			return { texture, mapping, bound, footprint };
+		}
+		// Calls `f(y, x0, count, origin)` for each row of pixels inside `clip`
+		// that a prepared texture covers, where the row's pixels run from x0
+		// to x0 + count - 1 and pixel x maps to `origin + draw.step() * x`.
+		template<typename F>
+		static void spans(Draw const &draw, Bound clip, F &&f) {
+			Bound const &tb = draw.texture->bound;
+			Bound const bb = draw.bound.clip(clip);
+			float const *const m = draw.mapping.data;
+			for(int y = (int)ceil(bb.min[1]), y1 = (int)floor(bb.max[1]); y <= y1; ++y) {
+				// Trim the row to where the texture point stays inside the bound.
+				Vec2F const origin{ m[1] * y + m[2], m[4] * y + m[5] };
+				float lo = bb.min[0], hi = bb.max[0];
+				for(unsigned a = 0; a < 2; ++a) {
+					float const d = m[a * 3], c = origin[a];
+					if(d == 0) {
+						if(c < tb.min[a] || c > tb.max[a])
+							hi = lo - 1;
+						continue;
+					}
+					float t0 = (tb.min[a] - c) / d, t1 = (tb.max[a] - c) / d;
+					if(t0 > t1)
+						swap(t0, t1);
+					lo = std::max(lo, t0);
+					hi = std::min(hi, t1);
+				}
+				int const x0 = (int)ceil(lo), x1 = (int)floor(hi);
+				if(x0 > x1)
+					continue;
+				f(y, x0, (unsigned)(x1 - x0 + 1), origin);
+			}
+		}
+		// Draws a prepared texture over the buffer, visiting only the pixels
+		// inside `clip` that the texture covers, and returns their number.
+		// `scratch` must hold a row of the clip. The result of each pixel
+		// only depends on the pixel, so drawing a texture in separate clips
+		// matches drawing it at once.
+		unsigned rasterize(Draw const &draw, Bound clip, Color *scratch) {
+			return rasterize(draw, clip, scratch, buffer->view(), { 0, 0 }, ids.empty() ? nullptr : ids.data());
+		}
+		// Same, drawing into `target`, whose pixel (0, 0) lies over buffer
+		// pixel `at`, and tagging `target_ids`, laid out with the target's
+		// stride, unless null. `clip` is in buffer pixels and must lie
+		// within the target.
+		static unsigned rasterize(
+			Draw const &draw, Bound clip, Color *scratch,
+			BitmapView target, Vec2I at, Entity **target_ids
+		) {
+			Vec2F const step = draw.step();
+			unsigned shaded = 0;
+			spans(draw, clip, [&](int y, int x0, unsigned count, Vec2F origin) {
+				draw.texture->span(scratch, count, origin, step, x0, draw.footprint);
+				Color *const dest = target.row(y - at[1]) + x0 - at[0];
+				if(target_ids)
+					tag(target_ids + (dest - target.data), scratch, count, draw.texture->entity);
+				blendpremultiplied(dest, scratch, count);
+				shaded += count;
+			});
+			return shaded;
+		}
+		// Records `entity` as drawn over the pixels it does not leave fully
+		// transparent, given the row of its samples.
+		static inline void tag(Entity **ids, Color const *samples, unsigned count, Entity *entity) {
+			for(unsigned i = 0; i < count; ++i) {
+				if(samples[i].a)
+					ids[i] = entity;
+			}
+		}
+		// Fills the ID buffer for a texture drawn by other means than
+		// rasterize().
+		void tag(Draw const &draw, Bound clip, Color *scratch) {
+			if(ids.empty())
+				return;
+			Vec2F const step = draw.step();
+			unsigned const pitch = buffer->pitch;
+			spans(draw, clip, [&](int y, int x0, unsigned count, Vec2F origin) {
+				draw.texture->span(scratch, count, origin, step, x0, draw.footprint);
+				tag(ids.data() + y * pitch + x0, scratch, count, draw.texture->entity);
+			});
+		}
 		virtual bool validate(Entity const *entity) = 0;
 		virtual bool compare(Entity const *a, Entity const *b) = 0;
+		// Fills the queue with the entities to draw, in drawing order.
+		virtual void collect() {
+			Scene *scene = entity->scene;
+			copy_if(
+				scene->entities.begin(),
+				scene->entities.end(),
+				back_inserter(queue),
+				[&](Entity const *e) { return validate(e); }
+			);
+			sort(
+				queue.begin(), queue.end(),
+				[&](Entity const *a, Entity const *b) { return compare(a, b); }
+			);
+		}
 		inline void clear() {
-			memset(buffer.data.get(), 0, buffer.size * sizeof(Color));
+			buffer->view().fill(Color());
+		}
+		// Clears a rectangle of the buffer, and of the ID buffer if kept.
+		void clear(Bound const &rect) {
+			unsigned const pitch = buffer->pitch;
+			unsigned const x0 = (unsigned)rect.min[0], y0 = (unsigned)rect.min[1];
+			Vec2U const size{ (unsigned)rect.max[0] - x0 + 1, (unsigned)rect.max[1] - y0 + 1 };
+			buffer->view().sub({ x0, y0 }, size).fill(Color());
+			if(ids.empty())
+				return;
+			for(unsigned y = y0; y < y0 + size[1]; ++y)
+				fill_n(ids.data() + y * pitch + x0, size[0], nullptr);
+		}
+		// Whether a buffer pixel is inside this paint's clips.
+		inline bool inclips(Vec2F p) const {
+			for(Bound const &clip : clips) {
+				if(clip.in(p))
+					return true;
+			}
+			return false;
 		}
+		// Buffer-space bound of scene damage, or an empty bound if the
+		// damage is not in this renderer's space.
+		virtual Bound damaged(Damage const &damage) const = 0;
 		virtual void sample() = 0;
 	public:
 		unsigned order;
+		// Topmost entity drawn at a buffer pixel. With `pick_buffer` set,
+		// a lookup into the last paint that honors draw order and
+		// transparency; otherwise tests every entity's bound.
 		virtual Entity *cast(Vec2F bufferp) {
+			if(pick_buffer && ids.size() == buffer->size) {
+				Vec2I const p{ (int)floor(bufferp[0]), (int)floor(bufferp[1]) };
+				return buffer->valid(p) ? ids[buffer->locate(p)] : nullptr;
+			}
 			for(Entity *target : entity->scene->entities) {
 				if(!validate(target))
 					continue;
@@ -190,7 +579,67 @@ namespace Win32GameEngine {
 			return nullptr;
 		}
 		bool clear_on_paint;
+		// Keeps an ID buffer while painting, for constant-time cast().
+		bool pick_buffer;
+		// Lets textures with mips sample the level matching their on-screen
+		// size, rather than always the full-size one.
+		bool mipmapping;
+		// Redraws the whole buffer at the next paint, for changes that
+		// damage does not track.
+		inline void invalidate() { stale = changed = true; }
 	};
+
+	inline void Compositor::submit(Renderer *renderer) {
+		auto const at = upper_bound(
+			pending.begin(), pending.end(), renderer->order,
+			[](unsigned order, Renderer const *r) { return order < r->order; }
+		);
+		pending.insert(at, renderer);
+	}
+
+	inline void Compositor::compose(Game *game) {
+		Bitmap &frame = game->window->buffer;
+		layers.clear();
+		for(size_t i = 0; i < pending.size(); ++i) {
+			Renderer *const renderer = pending[i];
+			// Drawing over a cleared frame equals blending over it.
+			if(!i && game->clear_frame_buffer) {
+				renderer->draw(&frame);
+				continue;
+			}
+			if(!renderer->canvas)
+				renderer->canvas = make_unique<Bitmap>(frame.dimension);
+			renderer->draw(renderer->canvas.get());
+			if(!renderer->blank)
+				layers.push_back(renderer->canvas.get());
+		}
+		pending.clear();
+		if(layers.empty())
+			return;
+		Bound const whole({ 0, 0 }, Vec2F(frame.dimension) - Vec2F{ 1, 1 });
+		rects.clear();
+		for(Bound const &rect : game->paint_rects) {
+			Bound const b = rect.clip(whole);
+			if(!b.empty())
+				rects.push_back(b);
+		}
+		Renderer::merge(rects);
+		BitmapView const dest = frame.view();
+		for(Bound const &rect : rects) {
+			unsigned const x0 = (unsigned)ceil(rect.min[0]), x1 = (unsigned)floor(rect.max[0]);
+			unsigned const count = x1 - x0 + 1;
+			// All layers are blended into a row while it is in cache.
+			for(unsigned y = (unsigned)ceil(rect.min[1]), y1 = (unsigned)floor(rect.max[1]); y <= y1; ++y) {
+				for(Bitmap const *const layer : layers)
+					blendpremultiplied(dest.row(y) + x0, layer->view().row(y) + x0, count);
+			}
+		}
+	}
+
+	inline void Game::compose() {
+		if(compositor)
+			compositor->compose(this);
+	}
 }
 
 #include "camera.hpp"
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "utils.hpp"
+#include <bit>
+#include <unordered_map>
+#include <vector>
+
+namespace Win32GameEngine {
+	class Entity;
+
+	// Entities kept sorted by a cached float key across frames, lowest
+	// first. Key changes, additions and removals are only recorded as
+	// they happen; the next read re-sorts, by inserting the few changed
+	// entries into place, or by a radix sort on the keys when many
+	// changed. Entries with equal keys keep their previous order, and
+	// new ones go after them.
+	class RenderList {
+	public:
+		// Changed entries beyond this are sorted in by a radix sort.
+		static constexpr size_t insertion_limit = 32;
+	protected:
+		struct Slot {
+			float key;
+			// Position in `items`, valid once listed.
+			unsigned index;
+			bool listed, changed;
+			unsigned stamp;
+		};
+		struct Item {
+			float key;
+			Entity *entity;
+			Slot *slot;
+		};
+		unordered_map<Entity *, Slot> slots;
+		vector<Item> items, spare;
+		vector<Entity *> order;
+		// Entities added or rekeyed since the last sort.
+		vector<Entity *> pending;
+		vector<pair<unsigned, Entity *>> positions;
+		bool removed;
+		unsigned stamp;
+		// Float bits mapped to unsigned integers of the same order.
+		static inline unsigned radixkey(float f) {
+			unsigned const u = bit_cast<unsigned>(f);
+			return u & 0x80000000U ? ~u : u | 0x80000000U;
+		}
+		void radixsort() {
+			size_t const n = items.size();
+			spare.resize(n);
+			for(unsigned shift = 0; shift < 32; shift += 8) {
+				size_t count[257] = {};
+				for(Item const &item : items)
+					++count[(radixkey(item.key) >> shift & 0xFF) + 1];
+				// Skip passes where every key has the same digit.
+				bool same = false;
+				for(unsigned d = 1; d <= 256; ++d) {
+					if(count[d] == n) {
+						same = true;
+						break;
+					}
+				}
+				if(same)
+					continue;
+				for(unsigned d = 1; d <= 256; ++d)
+					count[d] += count[d - 1];
+				for(Item const &item : items)
+					spare[count[radixkey(item.key) >> shift & 0xFF]++] = item;
+				items.swap(spare);
+			}
+		}
+		void resolve() {
+			if(pending.empty() && !removed)
+				return;
+			// Take out removed and changed entries, then put back the
+			// changed ones with their new keys.
+			size_t kept = 0;
+			for(Item const &item : items) {
+				if(item.slot && !item.slot->changed)
+					items[kept++] = item;
+			}
+			items.resize(kept);
+			size_t const added = pending.size();
+			for(Entity *const entity : pending) {
+				auto const it = slots.find(entity);
+				if(it == slots.end() || !it->second.changed)
+					continue;
+				Slot &slot = it->second;
+				slot.changed = false;
+				slot.listed = true;
+				Item const item{ slot.key, entity, &slot };
+				if(added <= insertion_limit) {
+					auto const at = upper_bound(
+						items.begin(), items.end(), item.key,
+						[](float key, Item const &i) { return key < i.key; }
+					);
+					items.insert(at, item);
+				}
+				else
+					items.push_back(item);
+			}
+			if(added > insertion_limit)
+				radixsort();
+			pending.clear();
+			removed = false;
+			order.resize(items.size());
+			for(size_t i = 0; i < items.size(); ++i) {
+				items[i].slot->index = (unsigned)i;
+				order[i] = items[i].entity;
+			}
+		}
+	public:
+		RenderList() : removed(false), stamp(0) {}
+		inline size_t size() const { return slots.size(); }
+		inline bool empty() const { return slots.empty(); }
+		inline bool contains(Entity *entity) const { return slots.find(entity) != slots.end(); }
+		// Adds an entity or changes its key.
+		void update(Entity *entity, float key) {
+			auto const [it, added] = slots.try_emplace(entity, Slot{ key, 0, false, false, 0 });
+			Slot &slot = it->second;
+			if(!added && slot.key == key)
+				return;
+			slot.key = key;
+			if(slot.changed)
+				return;
+			slot.changed = true;
+			pending.push_back(entity);
+		}
+		void remove(Entity *entity) {
+			auto const it = slots.find(entity);
+			if(it == slots.end())
+				return;
+			Slot const &slot = it->second;
+			if(slot.listed) {
+				items[slot.index].slot = nullptr;
+				removed = true;
+			}
+			slots.erase(it);
+		}
+		// All entities, sorted.
+		vector<Entity *> const &entities() {
+			resolve();
+			return order;
+		}
+		// Sorts a subset of the listed entities into list order; entities
+		// not listed are dropped.
+		void sort(vector<Entity *> &subset) {
+			resolve();
+			if(subset.size() == order.size()) {
+				subset = order;
+				return;
+			}
+			// Large subsets are picked out of the list in one pass; small
+			// ones sorted by their positions in it.
+			if(subset.size() * 8 >= order.size()) {
+				if(!++stamp)
+					++stamp;
+				for(Entity *const entity : subset) {
+					auto const it = slots.find(entity);
+					if(it != slots.end())
+						it->second.stamp = stamp;
+				}
+				subset.clear();
+				for(Item const &item : items) {
+					if(item.slot->stamp == stamp)
+						subset.push_back(item.entity);
+				}
+				return;
+			}
+			positions.clear();
+			for(Entity *const entity : subset) {
+				auto const it = slots.find(entity);
+				if(it != slots.end())
+					positions.emplace_back(it->second.index, entity);
+			}
+			std::sort(positions.begin(), positions.end());
+			subset.clear();
+			for(auto const &[index, entity] : positions)
+				subset.push_back(entity);
+		}
+	};
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#if defined(__AVX__)
+#define WIN32GE_AVX
+#endif
+#if defined(__AVX2__)
+#define WIN32GE_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WIN32GE_SSE2
+#endif
+
+#ifdef WIN32GE_SSE2
+#include <immintrin.h>
+#endif
+
+namespace Win32GameEngine {
+	// Fixed-size float kernels for the hot paths of linear.hpp.
+	// All matrices are row-major; every kernel has a scalar fallback.
+	namespace SIMD {
+#ifdef WIN32GE_SSE2
+		inline __m128 load3(float const *p) {
+			__m128 xy = _mm_castsi128_ps(_mm_loadl_epi64((__m128i const *)p));
+			return _mm_movelh_ps(xy, _mm_load_ss(p + 2));
+		}
+		inline void store3(float *p, __m128 v) {
+			_mm_storel_epi64((__m128i *)p, _mm_castps_si128(v));
+			_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+		}
+		// Sums of the four vectors' lanes, i.e. { sum(a), sum(b), sum(c), sum(d) }.
+		inline __m128 hsum4(__m128 a, __m128 b, __m128 c, __m128 d) {
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			return _mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d));
+		}
+#endif
+
+		// A register's worth of floats, used to vectorize loops across
+		// independent elements (e.g. points stored as separate arrays).
+		struct Float {
+#if defined(WIN32GE_AVX)
+			static constexpr unsigned width = 8;
+			__m256 v;
+			static inline Float load(float const *p) { return { _mm256_loadu_ps(p) }; }
+			static inline Float set1(float f) { return { _mm256_set1_ps(f) }; }
+			inline void store(float *p) const { _mm256_storeu_ps(p, v); }
+			inline Float operator+(Float f) const { return { _mm256_add_ps(v, f.v) }; }
+			inline Float operator*(Float f) const { return { _mm256_mul_ps(v, f.v) }; }
+			inline Float operator/(Float f) const { return { _mm256_div_ps(v, f.v) }; }
+#elif defined(WIN32GE_SSE2)
+			static constexpr unsigned width = 4;
+			__m128 v;
+			static inline Float load(float const *p) { return { _mm_loadu_ps(p) }; }
+			static inline Float set1(float f) { return { _mm_set1_ps(f) }; }
+			inline void store(float *p) const { _mm_storeu_ps(p, v); }
+			inline Float operator+(Float f) const { return { _mm_add_ps(v, f.v) }; }
+			inline Float operator*(Float f) const { return { _mm_mul_ps(v, f.v) }; }
+			inline Float operator/(Float f) const { return { _mm_div_ps(v, f.v) }; }
+#else
+			static constexpr unsigned width = 1;
+			float v;
+			static inline Float load(float const *p) { return { *p }; }
+			static inline Float set1(float f) { return { f }; }
+			inline void store(float *p) const { *p = v; }
+			inline Float operator+(Float f) const { return { v + f.v }; }
+			inline Float operator*(Float f) const { return { v * f.v }; }
+			inline Float operator/(Float f) const { return { v / f.v }; }
+#endif
+		};
+
+		// out = m * v for a 4x4 matrix.
+		inline void transform4(float const *m, float const *v, float *out) {
+#ifdef WIN32GE_SSE2
+			__m128 x = _mm_loadu_ps(v);
+			_mm_storeu_ps(out, hsum4(
+				_mm_mul_ps(_mm_loadu_ps(m), x),
+				_mm_mul_ps(_mm_loadu_ps(m + 4), x),
+				_mm_mul_ps(_mm_loadu_ps(m + 8), x),
+				_mm_mul_ps(_mm_loadu_ps(m + 12), x)
+			));
+#else
+			float res[4];
+			for(unsigned i = 0; i < 4; ++i) {
+				float const *r = m + i * 4;
+				res[i] = r[0] * v[0] + r[1] * v[1] + r[2] * v[2] + r[3] * v[3];
+			}
+			for(unsigned i = 0; i < 4; ++i)
+				out[i] = res[i];
+#endif
+		}
+
+		// out = a * b for 4x4 matrices. `out` may alias either operand.
+		inline void compose4(float const *a, float const *b, float *out) {
+#if defined(WIN32GE_AVX)
+			__m256 b0 = _mm256_broadcast_ps((__m128 const *)b);
+			__m256 b1 = _mm256_broadcast_ps((__m128 const *)(b + 4));
+			__m256 b2 = _mm256_broadcast_ps((__m128 const *)(b + 8));
+			__m256 b3 = _mm256_broadcast_ps((__m128 const *)(b + 12));
+			__m256 res[2];
+			for(unsigned i = 0; i < 2; ++i) {
+				// Rows 2i and 2i + 1 of `a`, one per 128-bit lane.
+				__m256 r = _mm256_loadu_ps(a + i * 8);
+				res[i] = _mm256_add_ps(
+					_mm256_add_ps(
+						_mm256_mul_ps(_mm256_permute_ps(r, 0x00), b0),
+						_mm256_mul_ps(_mm256_permute_ps(r, 0x55), b1)
+					),
+					_mm256_add_ps(
+						_mm256_mul_ps(_mm256_permute_ps(r, 0xAA), b2),
+						_mm256_mul_ps(_mm256_permute_ps(r, 0xFF), b3)
+					)
+				);
+			}
+			_mm256_storeu_ps(out, res[0]);
+			_mm256_storeu_ps(out + 8, res[1]);
+#elif defined(WIN32GE_SSE2)
+			__m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4);
+			__m128 b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+			__m128 res[4];
+			for(unsigned i = 0; i < 4; ++i) {
+				float const *r = a + i * 4;
+				res[i] = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[0]), b0), _mm_mul_ps(_mm_set1_ps(r[1]), b1)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[2]), b2), _mm_mul_ps(_mm_set1_ps(r[3]), b3))
+				);
+			}
+			for(unsigned i = 0; i < 4; ++i)
+				_mm_storeu_ps(out + i * 4, res[i]);
+#else
+			float res[16];
+			for(unsigned r = 0; r < 4; ++r) {
+				for(unsigned c = 0; c < 4; ++c) {
+					float const *x = a + r * 4;
+					res[r * 4 + c] = x[0] * b[c] + x[1] * b[4 + c] + x[2] * b[8 + c] + x[3] * b[12 + c];
+				}
+			}
+			for(unsigned i = 0; i < 16; ++i)
+				out[i] = res[i];
+#endif
+		}
+
+		// out = m * v for a 3x3 matrix.
+		inline void transform3(float const *m, float const *v, float *out) {
+#ifdef WIN32GE_SSE2
+			__m128 x = load3(v);
+			store3(out, hsum4(
+				_mm_mul_ps(load3(m), x),
+				_mm_mul_ps(load3(m + 3), x),
+				_mm_mul_ps(load3(m + 6), x),
+				_mm_setzero_ps()
+			));
+#else
+			float res[3];
+			for(unsigned i = 0; i < 3; ++i) {
+				float const *r = m + i * 3;
+				res[i] = r[0] * v[0] + r[1] * v[1] + r[2] * v[2];
+			}
+			for(unsigned i = 0; i < 3; ++i)
+				out[i] = res[i];
+#endif
+		}
+
+		// out = a * b for 3x3 matrices. `out` may alias either operand.
+		inline void compose3(float const *a, float const *b, float *out) {
+#ifdef WIN32GE_SSE2
+			__m128 b0 = load3(b), b1 = load3(b + 3), b2 = load3(b + 6);
+			__m128 res[3];
+			for(unsigned i = 0; i < 3; ++i) {
+				float const *r = a + i * 3;
+				res[i] = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[0]), b0), _mm_mul_ps(_mm_set1_ps(r[1]), b1)),
+					_mm_mul_ps(_mm_set1_ps(r[2]), b2)
+				);
+			}
+			for(unsigned i = 0; i < 3; ++i)
+				store3(out + i * 3, res[i]);
+#else
+			float res[9];
+			for(unsigned r = 0; r < 3; ++r) {
+				for(unsigned c = 0; c < 3; ++c) {
+					float const *x = a + r * 3;
+					res[r * 3 + c] = x[0] * b[c] + x[1] * b[3 + c] + x[2] * b[6 + c];
+				}
+			}
+			for(unsigned i = 0; i < 9; ++i)
+				out[i] = res[i];
+#endif
+		}
+	}
+}
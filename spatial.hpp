@@ -0,0 +1,242 @@
+#pragma once
+
+#include "utils.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace Win32GameEngine {
+	class Entity;
+
+	struct Bound {
+		using V = Vec2F;
+		V min, max;
+		Bound() : min{ INFINITY, INFINITY }, max{ -INFINITY, -INFINITY } {}
+		Bound(V min, V max) : Bound() {
+			add(min);
+			add(max);
+		}
+		Bound(Bound const &r) : Bound(V(r.min), V(r.max)) {}
+		V topleft() const { return min; }
+		V topright() const { return { max[0], min[1] }; }
+		V bottomright() const { return max; }
+		V bottomleft() const { return { min[0], max[1] }; }
+		void add(V point) {
+			min[0] = std::min(point[0], min[0]);
+			min[1] = std::min(point[1], min[1]);
+			max[0] = std::max(point[0], max[0]);
+			max[1] = std::max(point[1], max[1]);
+		}
+		// Transforms the corners by a callable mapping points to points.
+		template<typename F> requires (!requires { F::In::dimension; })
+		Bound transform(F const &f) const {
+			Bound res;
+			res.add(f(topleft()));
+			res.add(f(topright()));
+			res.add(f(bottomleft()));
+			res.add(f(bottomright()));
+			return res;
+		}
+		// Corners as separate coordinate arrays, in the order
+		// top-left, top-right, bottom-left, bottom-right.
+		void corners(float *x, float *y) const {
+			x[0] = x[2] = min[0];
+			x[1] = x[3] = max[0];
+			y[0] = y[1] = min[1];
+			y[2] = y[3] = max[1];
+		}
+		// Transforms the bound as lying on the z = 0 plane of a homogeneous
+		// matrix's space, using the batched point transform.
+		template<typename M> requires requires { M::In::dimension; }
+		Bound transform(M const &m) const {
+			Bound res;
+			transform(m, this, &res, 1);
+			return res;
+		}
+		// Transforms `count` bounds in one batch.
+		template<typename M> requires requires { M::In::dimension; }
+		static void transform(M const &m, Bound const *in, Bound *out, size_t count) {
+			constexpr unsigned D = M::In::dimension;
+			constexpr size_t chunk = 64;
+			float x[chunk * 4], y[chunk * 4], ox[chunk * 4], oy[chunk * 4], oz[chunk * 4];
+			float const *src[D - 1] = { x, y };
+			float *dest[D - 1] = { ox, oy };
+			if constexpr(D > 3)
+				dest[2] = oz;
+			for(size_t k = 0; k < count; k += chunk) {
+				size_t const n = std::min(chunk, count - k);
+				for(size_t i = 0; i < n; ++i)
+					in[k + i].corners(x + i * 4, y + i * 4);
+				m.transformpoints(src, dest, n * 4);
+				for(size_t i = 0; i < n; ++i) {
+					Bound &b = out[k + i] = Bound();
+					for(unsigned j = i * 4; j < i * 4 + 4; ++j)
+						b.add({ ox[j], oy[j] });
+				}
+			}
+		}
+		Bound clip(Bound r) const {
+			Bound res;
+			res.min[0] = std::max(r.min[0], min[0]);
+			res.min[1] = std::max(r.min[1], min[1]);
+			res.max[0] = std::min(r.max[0], max[0]);
+			res.max[1] = std::min(r.max[1], max[1]);
+			return res;
+		}
+		inline bool empty() const {
+			return !(min[0] <= max[0] && min[1] <= max[1]);
+		}
+		inline bool intersects(Bound const &r) const {
+			return (
+				min[0] <= r.max[0] && r.min[0] <= max[0] &&
+				min[1] <= r.max[1] && r.min[1] <= max[1]
+			);
+		}
+		inline bool in(Vec2F p) const {
+			return (
+				p[0] >= min[0] && p[1] >= min[1] &&
+				p[0] <= max[0] && p[1] <= max[1]
+			);
+		}
+	};
+
+	// Uniform grid over the world's xy plane, mapping each entry's bound
+	// to the cells it overlaps, so that a region query only visits
+	// entries near that region. Entries spanning too many cells are kept
+	// aside and tested on every query.
+	class SpatialIndex {
+	public:
+		static constexpr float default_cell_size = 16;
+		// Entries overlapping more cells than this are kept aside.
+		static constexpr unsigned max_cells = 64;
+	protected:
+		struct Entry {
+			Entity *entity;
+			Bound bound;
+			int x0, y0, x1, y1;
+			bool large;
+			unsigned stamp;
+		};
+		unordered_map<Entity *, Entry> entries;
+		unordered_map<unsigned long long, vector<Entry *>> cells;
+		vector<Entry *> large;
+		// Marks entries already reported by the running query.
+		unsigned stamp;
+		static inline unsigned long long key(int x, int y) {
+			return (unsigned long long)(unsigned)x << 32 | (unsigned)y;
+		}
+		inline int cell(float coordinate) const {
+			return (int)floor(coordinate / cell_size);
+		}
+		void link(Entry &entry) {
+			Bound const &b = entry.bound;
+			entry.x0 = cell(b.min[0]), entry.y0 = cell(b.min[1]);
+			entry.x1 = cell(b.max[0]), entry.y1 = cell(b.max[1]);
+			unsigned long long const count = (unsigned long long)(entry.x1 - entry.x0 + 1) * (entry.y1 - entry.y0 + 1);
+			entry.large = count > max_cells;
+			if(entry.large) {
+				large.push_back(&entry);
+				return;
+			}
+			for(int y = entry.y0; y <= entry.y1; ++y) {
+				for(int x = entry.x0; x <= entry.x1; ++x)
+					cells[key(x, y)].push_back(&entry);
+			}
+		}
+		static void detach(vector<Entry *> &list, Entry *entry) {
+			auto it = find(list.begin(), list.end(), entry);
+			*it = list.back();
+			list.pop_back();
+		}
+		void unlink(Entry &entry) {
+			if(entry.large) {
+				detach(large, &entry);
+				return;
+			}
+			for(int y = entry.y0; y <= entry.y1; ++y) {
+				for(int x = entry.x0; x <= entry.x1; ++x) {
+					auto it = cells.find(key(x, y));
+					detach(it->second, &entry);
+					if(it->second.empty())
+						cells.erase(it);
+				}
+			}
+		}
+	public:
+		float const cell_size;
+		// Depth range of all entries ever added. Only grows, so it may
+		// be wider than the current entries.
+		float zmin, zmax;
+		SpatialIndex(float cell_size = default_cell_size) :
+			stamp(0), cell_size(cell_size),
+			zmin(INFINITY), zmax(-INFINITY) {}
+		inline size_t size() const { return entries.size(); }
+		inline bool empty() const { return entries.empty(); }
+		// Adds an entity or moves it to a new bound at depth `z`.
+		void update(Entity *entity, Bound const &bound, float z) {
+			if(bound.empty()) {
+				remove(entity);
+				return;
+			}
+			zmin = std::min(zmin, z);
+			zmax = std::max(zmax, z);
+			auto it = entries.find(entity);
+			if(it == entries.end()) {
+				Entry &entry = entries[entity] = Entry{ entity, bound, 0, 0, 0, 0, false, stamp };
+				link(entry);
+				return;
+			}
+			Entry &entry = it->second;
+			entry.bound = bound;
+			// Only rebucket when the covered cells change.
+			if(
+				cell(bound.min[0]) == entry.x0 && cell(bound.min[1]) == entry.y0 &&
+				cell(bound.max[0]) == entry.x1 && cell(bound.max[1]) == entry.y1
+			)
+				return;
+			unlink(entry);
+			link(entry);
+		}
+		void remove(Entity *entity) {
+			auto it = entries.find(entity);
+			if(it == entries.end())
+				return;
+			unlink(it->second);
+			entries.erase(it);
+		}
+		// Calls `f(entity)` once for every entity whose bound intersects
+		// `region`.
+		template<typename F>
+		void query(Bound const &region, F &&f) {
+			if(region.empty())
+				return;
+			++stamp;
+			auto visit = [&](Entry &entry) {
+				if(entry.stamp == stamp)
+					return;
+				entry.stamp = stamp;
+				if(entry.bound.intersects(region))
+					f(entry.entity);
+			};
+			int const
+				x0 = cell(std::max(region.min[0], -1e9f)), y0 = cell(std::max(region.min[1], -1e9f)),
+				x1 = cell(std::min(region.max[0], 1e9f)), y1 = cell(std::min(region.max[1], 1e9f));
+			// A region wider than the populated grid is cheaper to scan whole.
+			if((double)(x1 - x0 + 1) * (y1 - y0 + 1) > (double)cells.size()) {
+				for(auto &[entity, entry] : entries)
+					visit(entry);
+				return;
+			}
+			for(Entry *entry : large)
+				visit(*entry);
+			for(int y = y0; y <= y1; ++y) {
+				for(int x = x0; x <= x1; ++x) {
+					auto it = cells.find(key(x, y));
+					if(it == cells.end())
+						continue;
+					for(Entry *entry : it->second)
+						visit(*entry);
+				}
+			}
+		}
+	};
+}
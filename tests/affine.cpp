@@ -0,0 +1,40 @@
+// AffineMatrix::inverse() in closed form against the Gaussian elimination
+// of SquareMatrix::inverse(), on random well-conditioned affine matrices.
+
+#include "test.hpp"
+#include "../linear.hpp"
+#include <cmath>
+#include <random>
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineTest;
+
+template<unsigned D>
+float worst(unsigned count, mt19937 &random) {
+	uniform_real_distribution<float> entry(-2, 2), translation(-100, 100);
+	float res = 0;
+	for(unsigned n = 0; n < count; ++n) {
+		AffineMatrix<D, float> m;
+		for(unsigned i = 0; i < D - 1; ++i) {
+			for(unsigned j = 0; j < D - 1; ++j)
+				m.data[i * D + j] = entry(random) + (i == j ? 4 : 0);
+			m.data[i * D + D - 1] = translation(random);
+		}
+		AffineMatrix<D, float> const closed = m.inverse();
+		SquareMatrix<D, float> const gaussian = ((SquareMatrix<D, float> const &)m).inverse();
+		for(unsigned i = 0; i < D * D; ++i) {
+			float const error = abs(closed.data[i] - gaussian.data[i]) / (1 + abs(gaussian.data[i]));
+			res = max(res, error);
+		}
+	}
+	return res;
+}
+
+int main() {
+	mt19937 random(2022);
+	float const e3 = worst<3>(10000, random), e4 = worst<4>(10000, random);
+	printf("largest relative difference: %g in 3x3, %g in 4x4\n", e3, e4);
+	check(e3 < 1e-4f, "3x3 inverse matches Gaussian elimination");
+	check(e4 < 1e-4f, "4x4 inverse matches Gaussian elimination");
+	return failures;
+}
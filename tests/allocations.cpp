@@ -0,0 +1,74 @@
+// Once every renderer has drawn once, an update and paint of a scene
+// where nothing changes must not touch the heap, whatever the camera
+// does. See Game::allocations.
+
+#define WIN32GE_TRACK_ALLOCATIONS
+#include "test.hpp"
+#include "../ui.hpp"
+#include "../bench/scene.hpp"
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineTest;
+using namespace Win32GameEngineBench;
+
+struct Mode {
+	char const *name;
+	Camera::Rasterization rasterization;
+	bool front_to_back, pick_buffer, partial_redraw;
+};
+
+void run(Mode const &mode) {
+	SpriteScene s(Vec2U{ 320, 240 });
+	Camera &c = s.camera->camera;
+	c.rasterization = mode.rasterization;
+	c.front_to_back = mode.front_to_back;
+	c.pick_buffer = mode.pick_buffer;
+	s.game.partial_redraw = mode.partial_redraw;
+	s.addsprites(gradient(16, true), 200, 20, Vec2F{ 1, 1 }, 1);
+	UIBase *const ui = new UIBase(s.scene);
+	ui->ui.order = 1;
+	ScreenEntity *const root = ui->ui.makeelement();
+	for(int i = 0; i < 20; ++i) {
+		ScreenEntity *const e = ui->ui.makeelement();
+		e->makecomponent<ColorBox>(Color(200, 10, 10, 128), Vec2F{ 20, 10 });
+		e->transform.position = Vec2F{ 10.f + i * 12, 20.f + i * 3 };
+		e->transform.z = (float)i;
+		if(i < 10)
+			e->transform.setparent(&root->transform);
+	}
+	ui->ui.setcached(root, true);
+	s.start();
+	// Paints are dispatched here rather than by the window, so they fall
+	// outside Game::allocations and are counted separately.
+	auto frame = [&]() {
+		s.game.update();
+		s.game.repaint();
+		s.paint(false);
+	};
+	for(int i = 0; i < 5; ++i)
+		frame();
+	Allocations const before = Allocations::now();
+	unsigned long long updates = 0;
+	for(int i = 0; i < 100; ++i) {
+		frame();
+		updates += s.game.allocations.frame.count;
+	}
+	unsigned long long const total = (Allocations::now() - before).count;
+	printf("%s: %llu allocations in updates, %llu in all\n", mode.name, updates, total);
+	check(updates == 0 && total == 0, mode.name);
+}
+
+int main() {
+	using enum Camera::Rasterization;
+	Mode const modes[] = {
+		{ "scanline", SCANLINE, false, false, false },
+		{ "pixelwise", PIXELWISE, false, false, false },
+		{ "tiled", TILED, false, false, false },
+		{ "tiled, front to back", TILED, true, false, false },
+		{ "pick buffer", SCANLINE, false, true, false },
+		{ "partial redraw", SCANLINE, false, false, true }
+	};
+	for(Mode const &mode : modes)
+		run(mode);
+	return failures;
+}
@@ -0,0 +1,53 @@
+// The blend() and blendpremultiplied() span kernels against the
+// per-pixel Color operators they stand for, bit for bit, over every pair
+// of source and destination alpha.
+
+#include "test.hpp"
+#include "../game.hpp"
+#include <random>
+#include <vector>
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineTest;
+
+// A random color of alpha `a`, premultiplied or not.
+Color randomcolor(mt19937 &random, unsigned a, bool premultiplied) {
+	uniform_int_distribution<unsigned> channel(0, premultiplied ? a : 255);
+	return Color(channel(random), channel(random), channel(random), a);
+}
+
+// Runs `kernel` over all 65536 alpha pairs, each with 16 random colors,
+// in spans of 1 to 40 pixels so that both the vector body and the scalar
+// tail are taken, and compares with `reference` applied pixel by pixel.
+// `source_major` keeps the source alpha for 256 pixels in a row, which
+// gives runs of clear and opaque sources; otherwise the destination
+// alpha, which gives runs over opaque destinations.
+template<typename Kernel, typename Reference>
+bool matches(Kernel kernel, Reference reference, bool premultiplied, bool source_major) {
+	constexpr unsigned count = 16 * 65536;
+	mt19937 r(2022);
+	vector<Color> src(count), dest(count), expected(count);
+	for(unsigned k = 0; k < count; ++k) {
+		unsigned const major = k >> 8 & 255, minor = k & 255;
+		src[k] = randomcolor(r, source_major ? major : minor, premultiplied);
+		dest[k] = randomcolor(r, source_major ? minor : major, premultiplied);
+		expected[k] = reference(dest[k], src[k]);
+	}
+	for(unsigned at = 0, length = 1; at < count; at += length, length = length % 40 + 1)
+		kernel(dest.data() + at, src.data() + at, std::min(length, count - at));
+	for(unsigned k = 0; k < count; ++k) {
+		if(bit_cast<unsigned>(dest[k]) != bit_cast<unsigned>(expected[k]))
+			return false;
+	}
+	return true;
+}
+
+int main() {
+	auto straight = [](Color const &d, Color const &s) { return d + s; };
+	auto premultiplied = [](Color const &d, Color const &s) { return d.composite(s); };
+	check(matches(blend, straight, false, true), "blend() over runs of one source alpha");
+	check(matches(blend, straight, false, false), "blend() over runs of one destination alpha");
+	check(matches(blendpremultiplied, premultiplied, true, true), "blendpremultiplied() over runs of one source alpha");
+	check(matches(blendpremultiplied, premultiplied, true, false), "blendpremultiplied() over runs of one destination alpha");
+	return failures;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// Shared by the programs in this directory. Each one is a standalone
+// console program over the headers in the repository root, built with
+// the engine's own settings, e.g.:
+//   cl /std:c++20 /O2 /EHsc /DUNICODE /D_UNICODE allocations.cpp user32.lib gdi32.lib
+// and exits with the number of failed checks.
+
+#include <cstdio>
+
+namespace Win32GameEngineTest {
+	inline int failures = 0;
+	// Reports `what` if `ok` is false.
+	inline bool check(bool ok, char const *what) {
+		if(!ok) {
+			++failures;
+			printf("FAILED: %s\n", what);
+		}
+		return ok;
+	}
+}
@@ -0,0 +1,84 @@
+// UI compositing against a pixel-by-pixel reference. The game's window
+// is never shown, and nothing is presented: the UI draws in software
+// straight into the window buffer, which is read back.
+
+#include "test.hpp"
+#include "../ui.hpp"
+
+using namespace Win32GameEngine;
+using namespace Win32GameEngineTest;
+
+int main() {
+	Window window(Window::InitArg{ .size = { 320, 240 } });
+	Game game(&window);
+	Scene *const scene = game.makescene();
+	UIBase *const base = new UIBase(scene);
+	UI &ui = base->ui;
+	Bitmap image(Vec2U{ 40, 30 });
+	for(unsigned y = 0; y < 30; ++y) {
+		for(unsigned x = 0; x < 40; ++x)
+			image.data.get()[image.locate(x, y)] = Color(x * 7 & 255, y * 13 & 255, (x ^ y) & 255, x * y & 255).premultiply();
+	}
+	vector<ScreenEntity *> elements;
+	ScreenEntity *const root = ui.makeelement();
+	for(int i = 0; i < 200; ++i) {
+		ScreenEntity *const e = ui.makeelement();
+		if(i % 2)
+			e->makecomponent<ColorBox>(Color(i, 255 - i, 7, 128 + i / 2), Vec2F{ 20, 12 });
+		else
+			e->makecomponent<Sprite>(image);
+		e->transform.position = Vec2F{ (float)(i * 37 % 300), (float)(i * 53 % 220) };
+		e->transform.z = (float)i;
+		elements.push_back(e);
+	}
+	scene->activate();
+	game.activate();
+
+	// The texture under every pixel, blended in z order.
+	Bitmap expected(window.buffer.dimension);
+	for(unsigned y = 0; y < expected.dimension[1]; ++y) {
+		for(unsigned x = 0; x < expected.dimension[0]; ++x) {
+			Color c;
+			for(ScreenEntity *const e : elements) {
+				Texture const *const texture = e->getcomponent<Texture>();
+				Vec2F const uv = Vec2F{ (float)x, (float)y } - e->transform.position();
+				if(texture->hit(uv)) {
+					Color const s = texture->sample(uv);
+					blendpremultiplied(&c, &s, 1);
+				}
+			}
+			expected.data.get()[expected.locate(x, y)] = c;
+		}
+	}
+	auto paint = [&]() {
+		game({ GameEventType::PAINT, Propagation::DOWN });
+		game({ GameEventType::POSTPAINT, Propagation::DOWN });
+	};
+	auto matches = [&]() {
+		for(unsigned y = 0; y < expected.dimension[1]; ++y) {
+			for(unsigned x = 0; x < expected.dimension[0]; ++x) {
+				if(bit_cast<unsigned>(window.buffer.data.get()[window.buffer.locate(x, y)]) != bit_cast<unsigned>(expected.data.get()[expected.locate(x, y)]))
+					return false;
+			}
+		}
+		return true;
+	};
+	paint();
+	check(matches(), "elements composited in z order");
+
+	// A cached layer holding the first ten elements lies between z 0 and
+	// 9, where nothing else does, so the picture stays the same.
+	for(int i = 0; i < 10; ++i)
+		elements[i]->transform.setparent(&root->transform);
+	ui.setcached(root, true);
+	paint();
+	check(matches(), "cached layer composited as its members");
+	paint();
+	check(matches(), "cached layer reused");
+
+	ui.pick_buffer = true;
+	paint();
+	check(matches(), "pick buffer leaves the picture alone");
+	check(ui.cast(elements[199]->transform.position() + Vec2F{ 1, 1 }) == elements[199], "pick buffer finds the topmost element");
+	return failures;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+
+namespace Win32GameEngine {
+	using namespace std;
+
+	// Fixed set of worker threads running batches of indexed tasks.
+	// Each participant owns a task deque; idle participants steal from
+	// the front of the others' deques, so uneven tasks balance out.
+	class ThreadPool {
+	private:
+		struct Queue {
+			mutex lock;
+			deque<unsigned> tasks;
+		};
+		vector<thread> workers;
+		// One queue per worker, plus the last one for the calling thread.
+		vector<unique_ptr<Queue>> queues;
+		// The running batch's callable, behind a pointer and a caller, so
+		// that no function object is built per batch.
+		void const *job;
+		void (*call)(void const *, unsigned);
+		atomic<unsigned> remaining;
+		mutex lock;
+		condition_variable wake, done;
+		unsigned generation;
+		bool stopping;
+		bool pop(unsigned self, unsigned &task) {
+			unsigned const n = (unsigned)queues.size();
+			{
+				Queue &own = *queues[self];
+				lock_guard<mutex> guard(own.lock);
+				if(!own.tasks.empty()) {
+					task = own.tasks.back();
+					own.tasks.pop_back();
+					return true;
+				}
+			}
+			for(unsigned i = 1; i < n; ++i) {
+				Queue &victim = *queues[(self + i) % n];
+				lock_guard<mutex> guard(victim.lock);
+				if(!victim.tasks.empty()) {
+					task = victim.tasks.front();
+					victim.tasks.pop_front();
+					return true;
+				}
+			}
+			return false;
+		}
+		void work(unsigned self) {
+			unsigned task;
+			while(pop(self, task)) {
+				call(job, task);
+				if(remaining.fetch_sub(1) == 1) {
+					lock_guard<mutex> guard(lock);
+					done.notify_all();
+				}
+			}
+		}
+		void loop(unsigned self) {
+			unsigned seen = 0;
+			for(;;) {
+				{
+					unique_lock<mutex> guard(lock);
+					wake.wait(guard, [&]() { return stopping || generation != seen; });
+					if(stopping)
+						return;
+					seen = generation;
+				}
+				work(self);
+			}
+		}
+	public:
+		// `threads` counts the calling thread, which takes part in `run`.
+		ThreadPool(unsigned threads) : job(nullptr), call(nullptr), remaining(0), generation(0), stopping(false) {
+			if(!threads)
+				threads = 1;
+			for(unsigned i = 0; i < threads; ++i)
+				queues.push_back(make_unique<Queue>());
+			for(unsigned i = 0; i + 1 < threads; ++i)
+				workers.emplace_back([this, i]() { loop(i); });
+		}
+		~ThreadPool() {
+			{
+				lock_guard<mutex> guard(lock);
+				stopping = true;
+			}
+			wake.notify_all();
+			for(thread &worker : workers)
+				worker.join();
+		}
+		inline unsigned size() const { return (unsigned)queues.size(); }
+		// Runs `f(0)` to `f(count - 1)` across the pool and blocks until all are done.
+		template<typename F>
+		void run(unsigned count, F const &f) {
+			if(!count)
+				return;
+			if(workers.empty()) {
+				for(unsigned i = 0; i < count; ++i)
+					f(i);
+				return;
+			}
+			job = &f;
+			call = [](void const *job, unsigned task) { (*(F const *)job)(task); };
+			remaining = count;
+			unsigned const n = size();
+			for(unsigned i = 0; i < count; ++i) {
+				Queue &queue = *queues[i % n];
+				lock_guard<mutex> guard(queue.lock);
+				queue.tasks.push_back(i);
+			}
+			{
+				lock_guard<mutex> guard(lock);
+				++generation;
+			}
+			wake.notify_all();
+			work(n - 1);
+			unique_lock<mutex> guard(lock);
+			done.wait(guard, [&]() { return remaining == 0; });
+		}
+	};
+}
@@ -6,7 +6,7 @@ namespace Win32GameEngine {
 	template<unsigned D, typename Impl>
 	class Transform : public Component {
 	public:
-		using Matrix = SquareMatrix<D, float>;
+		using Matrix = AffineMatrix<D, float>;
 		template<typename T>
 		struct Attribute {
 			Transform *const transform;
@@ -32,11 +32,17 @@ namespace Win32GameEngine {
 		virtual void updateworld() {
 			world = parent ? parent->world.compose(local) : local;
 		}
-		void update() {
-			((Impl *)this)->Impl::updatelocal();
+		// Recomputes the world matrices of this transform and all its
+		// descendants, notifying each one's entity.
+		void propagateworld() {
 			updateworld();
+			entity->operator()({ GameEventType::TRANSFORM, Propagation::DOWN });
 			for(Transform *child : children)
-				child->updateworld();
+				child->propagateworld();
+		}
+		void update() {
+			((Impl *)this)->Impl::updatelocal();
+			propagateworld();
 		}
 	};
 
@@ -65,7 +71,7 @@ namespace Win32GameEngine {
 				parent->children.erase(this);
 			if(parent = t)
 				parent->children.insert(this);
-			updateworld();
+			propagateworld();
 		}
 		virtual void updatelocal() override {
 			local.diag() = Vec4F{ 1, 1, 1, 1 };
@@ -96,7 +102,7 @@ namespace Win32GameEngine {
 				parent->children.erase(this);
 			if(parent = t)
 				parent->children.insert(this);
-			updateworld();
+			propagateworld();
 		}
 		virtual void updatelocal() override {
 			Vec3F diag = this->scale();
@@ -7,6 +7,103 @@ namespace Win32GameEngine {
 	class UI : public Renderer {
 	protected:
 		set<ScreenEntity *> elements;
+		// Active elements and layer roots by z, kept sorted across frames.
+		RenderList list;
+		set<ScreenEntity *> tracked;
+		// Keeps an entity's place in `list` in step with its z and
+		// activation.
+		void track(ScreenEntity *e) {
+			if(!tracked.insert(e).second)
+				return;
+			auto rekey = [=](GameEvent const &) {
+				if(e->isactive())
+					list.update(e, e->transform.z.value);
+				else
+					list.remove(e);
+			};
+			for(GameEventType type : { GameEventType::TRANSFORM, GameEventType::ACTIVATE, GameEventType::INACTIVATE })
+				e->add(type, rekey);
+			rekey({});
+		}
+		// A subtree drawn once into its own bitmap, then blended as a
+		// whole each paint until one of its textures changes.
+		struct Layer {
+			// Members to draw this paint, in drawing order.
+			vector<Entity *> members;
+			// Digest of the listed members and their texture versions, as
+			// Renderer::digest() mixes them, as of the last render and as
+			// collected for this paint.
+			unsigned long long rendered, state;
+			// Buffer pixel under the bitmap's top left pixel.
+			Vec2I at;
+			unique_ptr<Bitmap> bitmap;
+			vector<Entity *> ids;
+		};
+		map<ScreenEntity *, Layer> layers;
+		// Root of the cached subtree holding an element, if any.
+		Layer *layerof(ScreenEntity *element) {
+			for(Transform<3, ScreenTransform> *t = &element->transform; t; t = t->parent) {
+				auto it = layers.find((ScreenEntity *)t->entity);
+				if(it != layers.end())
+					return &it->second;
+			}
+			return nullptr;
+		}
+		// Redraws a layer's bitmap over the buffer pixels its members cover.
+		void render(Layer &layer) {
+			Bound bound;
+			FrameVector<Draw> draws(entity->scene->game->arena);
+			for(Entity *member : layer.members) {
+				draws.push_back(prepare(member->getcomponent<Texture>()));
+				Bound const b = draws.back().bound.clip(extent());
+				if(b.empty())
+					continue;
+				bound.add(b.min);
+				bound.add(b.max);
+			}
+			layer.rendered = layer.state;
+			if(bound.empty()) {
+				layer.bitmap.reset();
+				return;
+			}
+			Vec2I const min{ (int)ceil(bound.min[0]), (int)ceil(bound.min[1]) };
+			Vec2I const max{ (int)floor(bound.max[0]), (int)floor(bound.max[1]) };
+			Bound const rect{ Vec2F(min), Vec2F(max) };
+			layer.at = min;
+			layer.bitmap = make_unique<Bitmap>(Vec2U(max - min + Vec2I{ 1, 1 }));
+			if(pick_buffer)
+				layer.ids.assign(layer.bitmap->size, nullptr);
+			else
+				vector<Entity *>().swap(layer.ids);
+			for(Draw const &draw : draws)
+				rasterize(draw, rect, scanline.data(), layer.bitmap->view(), min, layer.ids.empty() ? nullptr : layer.ids.data());
+		}
+		// Blends a layer's bitmap over the buffer inside `clip`.
+		void blit(Layer const &layer, Bound clip) {
+			if(!layer.bitmap)
+				return;
+			Bitmap const &bitmap = *layer.bitmap;
+			Vec2I const at = layer.at;
+			Bound const b = clip.clip(Bound(Vec2F(at), Vec2F(at + Vec2I(bitmap.dimension) - Vec2I{ 1, 1 })));
+			if(b.empty())
+				return;
+			Vec2U const min{ (unsigned)ceil(b.min[0]), (unsigned)ceil(b.min[1]) };
+			Vec2U const size = Vec2U{ (unsigned)floor(b.max[0]), (unsigned)floor(b.max[1]) } - min + Vec2U{ 1, 1 };
+			BitmapView const dest = buffer->view().sub(min, size);
+			ConstBitmapView const src = bitmap.view().sub(Vec2U(Vec2I(min) - at), size);
+			dest.blit(src);
+			if(ids.empty() || layer.ids.empty())
+				return;
+			Color const *const buffer_origin = buffer->data.get();
+			for(unsigned y = 0; y < size[1]; ++y) {
+				Entity *const *const from = layer.ids.data() + (src.row(y) - bitmap.data.get());
+				Entity **const to = ids.data() + (dest.row(y) - buffer_origin);
+				for(unsigned i = 0; i < size[0]; ++i) {
+					if(Entity *const id = from[i])
+						to[i] = id;
+				}
+			}
+		}
 
 		virtual Vec2F screen_texture(Texture const *texture, Vec2F screenp) const override {
 			ScreenTransform &tt = ((ScreenEntity *)texture->entity)->transform;
@@ -20,7 +117,13 @@ namespace Win32GameEngine {
 			aug[2] = 1;
 			return tt.world(aug);
 		}
+		virtual AffineMatrix<3, float> texture_mapping(Texture const *texture) const override {
+			return ((ScreenEntity *)texture->entity)->transform.world.inverse();
+		}
 		virtual Vec2F buffer_screen(Vec2I screenp) const { return screenp; }
+		virtual Bound damaged(Damage const &damage) const override {
+			return damage.world ? Bound() : damage.bound;
+		}
 		virtual Vec2I screen_buffer(Vec2F bufferp) const { return bufferp; }
 		virtual bool validate(Entity const *entity) override {
 			if(!entity->isactive())
@@ -32,27 +135,78 @@ namespace Win32GameEngine {
 				return false;
 			return true;
 		}
+		virtual void collect() override {
+			for(auto &[root, layer] : layers) {
+				layer.members.clear();
+				layer.state = 0;
+			}
+			for(Entity *const e : list.entities()) {
+				ScreenEntity *const element = (ScreenEntity *)e;
+				// Layers are drawn at their root's place.
+				auto const root = layers.find(element);
+				if(root != layers.end()) {
+					queue.push_back(element);
+					if(elements.find(element) == elements.end())
+						continue;
+				}
+				Layer *const layer = layerof(element);
+				if(!layer) {
+					if(validate(element))
+						queue.push_back(element);
+					continue;
+				}
+				// Every listed texture counts towards the state, drawn or
+				// not, and hidden elements leave the list, so that any
+				// change dirties the layer.
+				if(Texture const *const texture = element->getcomponent<Texture>())
+					layer->state = (layer->state ^ (unsigned long long)(uintptr_t)element) * 0x100000001B3ULL + texture->version;
+				if(validate(element))
+					layer->members.push_back(element);
+			}
+		}
 		virtual bool compare(Entity const *a, Entity const *b) override {
 			return ((ScreenEntity *)a)->transform.z.value < ((ScreenEntity *)b)->transform.z.value;
 		}
+		// Composites the elements in software, straight into the buffer's
+		// memory; no GDI call is made per element.
 		virtual void sample() override {
 			for(Entity *const entity : queue) {
-				ScreenEntity *se = (ScreenEntity *)entity;
-				Texture *const texture = entity->getcomponent<Texture>();
-				Bound bound = texture->bound.transform([&](Vec2F v) {
-					Vec3F a = v;
-					a[2] = 1;
-					return se->transform.world(a);
-				});
-				texture->put(buffer, bound);
-				GetBitmapBits(buffer.gethandle(), buffer.size * sizeof(Color), buffer.data.get());
+				auto const it = layers.find((ScreenEntity *)entity);
+				if(it != layers.end()) {
+					Layer &layer = it->second;
+					if(layer.state != layer.rendered || (pick_buffer && layer.bitmap && layer.ids.empty()))
+						render(layer);
+					for(Bound const &clip : clips)
+						blit(layer, clip);
+					continue;
+				}
+				Draw const draw = prepare(entity->getcomponent<Texture>());
+				for(Bound const &clip : clips)
+					rasterize(draw, clip, scanline.data());
 			}
 		}
 	public:
 		UI(Entity *entity) : Renderer(entity) {}
+		// Caches the subtree under `root` as one layer, drawn at the root's
+		// depth. Changes to any texture or transform inside it redraw the
+		// layer at the next paint; elements outside the subtree cannot
+		// slot between its members.
+		void setcached(ScreenEntity *root, bool cached) {
+			if(cached) {
+				layers[root].rendered = ~0ULL;
+				track(root);
+			}
+			else
+				layers.erase(root);
+			invalidate();
+		}
+		inline bool iscached(ScreenEntity *root) const {
+			return layers.find(root) != layers.end();
+		}
 		ScreenEntity *makeelement() {
 			ScreenEntity *el = new ScreenEntity(entity->scene);
 			elements.insert(el);
+			track(el);
 			return el;
 		}
 	};
@@ -53,9 +53,46 @@ namespace Win32GameEngine {
 			delete[] data;
 		}
 	};
+	// A file mapped into memory, paged in as it is read instead of copied
+	// up front. A copy-on-write mapping may be written to; written pages
+	// become private copies and the file is left as it is.
+	struct MappedFile {
+		unsigned char const *data;
+		size_t size;
+		HANDLE file, mapping;
+		MappedFile(ConstString url, bool copy_on_write = false) : data(nullptr), size(0), file(INVALID_HANDLE_VALUE), mapping(NULL) {
+			auto path = filesystem::current_path();
+			path.append(url);
+			file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if(file == INVALID_HANDLE_VALUE)
+				throw L"File not found.";
+			LARGE_INTEGER length;
+			if(!GetFileSizeEx(file, &length) || !length.QuadPart) {
+				CloseHandle(file);
+				throw L"Empty file.";
+			}
+			size = (size_t)length.QuadPart;
+			mapping = CreateFileMappingW(file, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+			if(mapping)
+				data = (unsigned char const *)MapViewOfFile(mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+			if(!data) {
+				mapping && CloseHandle(mapping);
+				CloseHandle(file);
+				throw L"Cannot map file.";
+			}
+		}
+		MappedFile(MappedFile const &) = delete;
+		~MappedFile() {
+			UnmapViewOfFile(data);
+			CloseHandle(mapping);
+			CloseHandle(file);
+		}
+	};
 }
 
+#include "alloc.hpp"
 #include "linear.hpp"
+#include "thread.hpp"
 #include "buffer.hpp"
 #include "event.hpp"
 #include "window.hpp"
\ No newline at end of file